@@ -25,6 +25,7 @@ c_id = (
 c_void = P('void')
 c_param_type = (
   ((P('Error') * fill * P('*') * fill) * Cc('error')) +
+  ((P('Arena') * fill * P('*') * fill) * Cc('arena')) +
   (C(c_id) * (ws ^ 1))
   )
 c_type = (C(c_void) * (ws ^ 1)) + c_param_type
@@ -77,6 +78,12 @@ for i = 1, #arg - 1 do
       -- for specifying errors
       fn.parameters[#fn.parameters] = nil
     end
+    if #fn.parameters ~= 0 and fn.parameters[#fn.parameters][1] == 'arena' then
+      -- function allocates the return value from the request arena, which is
+      -- released after the response is sent
+      fn.arena_return = true
+      fn.parameters[#fn.parameters] = nil
+    end
   end
   input:close()
 end
@@ -162,7 +169,7 @@ for i = 1, #functions do
   local fn = functions[i]
   local args = {}
 
-  output:write('static Object handle_'..fn.name..'(uint64_t channel_id, uint64_t request_id, Array args, Error *error)')
+  output:write('static Object handle_'..fn.name..'(uint64_t channel_id, uint64_t request_id, Array args, Arena *arena, Error *error)')
   output:write('\n{')
   output:write('\n  Object ret = NIL;')
   -- Declare/initialize variables that will hold converted arguments
@@ -226,9 +233,18 @@ for i = 1, #functions do
     output:write(call_args)
   end
 
+  if fn.arena_return then
+    -- pass the request arena before the error pointer
+    if #args > 0 or fn.receives_channel_id then
+      output:write(', arena')
+    else
+      output:write('arena')
+    end
+  end
+
   if fn.can_fail then
     -- if the function can fail, also pass a pointer to the local error object
-    if #args > 0 then
+    if #args > 0 or fn.receives_channel_id or fn.arena_return then
       output:write(', error);\n')
     else
       output:write('error);\n')
@@ -244,14 +260,9 @@ for i = 1, #functions do
   if fn.return_type ~= 'void' then
     output:write('\n  ret = '..string.upper(real_type(fn.return_type))..'_OBJ(rv);')
   end
-  -- Now generate the cleanup label for freeing memory allocated for the
-  -- arguments
+  -- Arguments are owned by the caller(they are allocated from the request
+  -- arena), so the cleanup label only needs to return
   output:write('\n\ncleanup:');
-
-  for j = 1, #fn.parameters do
-    local param = fn.parameters[j]
-    output:write('\n  api_free_'..string.lower(real_type(param[1]))..'(arg_'..j..');')
-  end
   output:write('\n  return ret;\n}\n\n');
 end
 
@@ -279,7 +290,8 @@ for i = 1, #functions do
                '(String) {.data = "'..fn.name..'", '..
                '.size = sizeof("'..fn.name..'") - 1}, '..
                '(MsgpackRpcRequestHandler) {.fn = handle_'..  fn.name..
-               ', .async = '..tostring(fn.async)..'});\n')
+               ', .async = '..tostring(fn.async)..
+               ', .arena_return = '..tostring(fn.arena_return == true)..'});\n')
 
   if #fn.name > max_fname_len then
     max_fname_len = #fn.name
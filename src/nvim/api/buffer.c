@@ -5,12 +5,14 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <string.h>
 
 #include "nvim/api/buffer.h"
 #include "nvim/api/private/helpers.h"
 #include "nvim/api/private/defs.h"
 #include "nvim/vim.h"
 #include "nvim/buffer.h"
+#include "nvim/buffer_updates.h"
 #include "nvim/cursor.h"
 #include "nvim/memline.h"
 #include "nvim/memory.h"
@@ -52,7 +54,8 @@ Integer buffer_line_count(Buffer buffer, Error *err)
 String buffer_get_line(Buffer buffer, Integer index, Error *err)
 {
   String rv = {.size = 0};
-  Array slice = buffer_get_line_slice(buffer, index, index, true, true, err);
+  Array slice = buffer_get_line_slice(buffer, index, index, true, true, NULL,
+                                      err);
 
   if (!err->set && slice.size) {
     rv = slice.items[0].data.string;
@@ -94,6 +97,8 @@ void buffer_del_line(Buffer buffer, Integer index, Error *err)
 /// @param end The last line index
 /// @param include_start True if the slice includes the `start` parameter
 /// @param include_end True if the slice includes the `end` parameter
+/// @param arena Arena the result is allocated from. If NULL, it is allocated
+///        on the heap and must be freed by the caller.
 /// @param[out] err Details of an error that may have occurred
 /// @return An array of lines
 ArrayOf(String) buffer_get_line_slice(Buffer buffer,
@@ -101,6 +106,7 @@ ArrayOf(String) buffer_get_line_slice(Buffer buffer,
                                  Integer end,
                                  Boolean include_start,
                                  Boolean include_end,
+                                 Arena *arena,
                                  Error *err)
 {
   Array rv = ARRAY_DICT_INIT;
@@ -120,33 +126,49 @@ ArrayOf(String) buffer_get_line_slice(Buffer buffer,
   }
 
   rv.size = (size_t)(end - start);
-  rv.items = xcalloc(sizeof(Object), rv.size);
+  if (arena) {
+    // The lines only live until the response is serialized, so copying them
+    // into the request arena saves a malloc/free pair per line.
+    rv.items = arena_alloc(arena, sizeof(Object) * rv.size, true);
+    memset(rv.items, 0, sizeof(Object) * rv.size);
+  } else {
+    rv.items = xcalloc(sizeof(Object), rv.size);
+  }
 
-  for (size_t i = 0; i < rv.size; i++) {
-    int64_t lnum = start + (int64_t)i;
+  if (end - 1 > LONG_MAX) {
+    api_set_error(err, Validation, _("Line index is too high"));
+    goto end;
+  }
 
-    if (lnum > LONG_MAX) {
-      api_set_error(err, Validation, _("Line index is too high"));
-      goto end;
-    }
+  MemlineIter iter;
+  ml_iter_init(&iter, buf, (linenr_T)start, (linenr_T)(end - 1));
+  char_u *line;
+  size_t len;
 
-    const char *bufstr = (char *) ml_get_buf(buf, (linenr_T) lnum, false);
-    Object str = STRING_OBJ(cstr_to_string(bufstr));
+  for (size_t i = 0; i < rv.size && ml_iter_next(&iter, &line, &len); i++) {
+    const char *bufstr = (char *)line;
+    String str = {
+      .data = arena ? arena_memdupz(arena, bufstr, len) : xmemdupz(bufstr, len),
+      .size = len
+    };
 
     // Vim represents NULs as NLs, but this may confuse clients.
-    strchrsub(str.data.string.data, '\n', '\0');
+    strchrsub(str.data, '\n', '\0');
 
-    rv.items[i] = str;
+    rv.items[i] = STRING_OBJ(str);
   }
 
 end:
   if (err->set) {
-    for (size_t i = 0; i < rv.size; i++) {
-      xfree(rv.items[i].data.string.data);
-    }
+    if (!arena) {
+      for (size_t i = 0; i < rv.size; i++) {
+        xfree(rv.items[i].data.string.data);
+      }
 
-    xfree(rv.items);
+      xfree(rv.items);
+    }
     rv.items = NULL;
+    rv.size = 0;
   }
 
   return rv;
@@ -231,61 +253,41 @@ void buffer_set_line_slice(Buffer buffer,
     goto end;
   }
 
-  // If the size of the range is reducing (ie, new_len < old_len) we
-  // need to delete some old_len. We do this at the start, by
-  // repeatedly deleting line "start".
-  size_t to_delete = (new_len < old_len) ? (size_t)(old_len - new_len) : 0;
-  for (size_t i = 0; i < to_delete; i++) {
-    if (ml_delete((linenr_T)start, false) == FAIL) {
-      api_set_error(err, Exception, _("Failed to delete line"));
-      goto end;
-    }
-  }
-
-  if ((ssize_t)to_delete > 0) {
-    extra -= (ssize_t)to_delete;
+  if (start + (int64_t)new_len > LONG_MAX) {
+    api_set_error(err, Validation, _("Index value is too high"));
+    goto end;
   }
 
-  // For as long as possible, replace the existing old_len with the
-  // new old_len. This is a more efficient operation, as it requires
-  // less memory allocation and freeing.
-  size_t to_replace = old_len < new_len ? old_len : new_len;
-  for (size_t i = 0; i < to_replace; i++) {
-    int64_t lnum = start + (int64_t)i;
-
-    if (lnum > LONG_MAX) {
-      api_set_error(err, Validation, _("Index value is too high"));
-      goto end;
-    }
-
-    if (ml_replace((linenr_T)lnum, (char_u *)lines[i], false) == FAIL) {
+  // Replace the first line, so that the buffer never becomes empty, then
+  // delete the other old lines and append the other new lines in bulk.
+  // Replacing lines one by one would move the text of a data block for every
+  // line, deleting and appending goes over each block once.
+  size_t replaced = 0;
+  if (old_len > 0 && new_len > 0) {
+    if (ml_replace((linenr_T)start, (char_u *)lines[0], false) == FAIL) {
       api_set_error(err, Exception, _("Failed to replace line"));
       goto end;
     }
     // Mark lines that haven't been passed to the buffer as they need
     // to be freed later
-    lines[i] = NULL;
+    lines[0] = NULL;
+    replaced = 1;
   }
 
-  // Now we may need to insert the remaining new old_len
-  for (size_t i = to_replace; i < new_len; i++) {
-    int64_t lnum = start + (int64_t)i - 1;
-
-    if (lnum > LONG_MAX) {
-      api_set_error(err, Validation, _("Index value is too high"));
-      goto end;
-    }
-
-    if (ml_append((linenr_T)lnum, (char_u *)lines[i], 0, false) == FAIL) {
-      api_set_error(err, Exception, _("Failed to insert line"));
-      goto end;
-    }
+  if (ml_delete_lines((linenr_T)(start + (int64_t)replaced),
+                      (long)(old_len - replaced), false) == FAIL) {
+    api_set_error(err, Exception, _("Failed to delete line"));
+    goto end;
+  }
+  extra -= (ssize_t)(old_len - replaced);
 
-    // Same as with replacing, but we also need to free lines
-    xfree(lines[i]);
-    lines[i] = NULL;
-    extra++;
+  if (ml_append_lines((linenr_T)(start + (int64_t)replaced - 1),
+                      (char_u **)lines + replaced,
+                      (long)(new_len - replaced)) == FAIL) {
+    api_set_error(err, Exception, _("Failed to insert line"));
+    goto end;
   }
+  extra += (ssize_t)(new_len - replaced);
 
   // Adjust marks. Invalidate any which lie in the
   // changed range, and move any in the remainder of the buffer.
@@ -455,6 +457,55 @@ Boolean buffer_is_valid(Buffer buffer)
   return find_buffer_by_handle(buffer, &stub) != NULL;
 }
 
+/// Subscribes to line change events of a buffer
+///
+/// After each change the channel receives a `buffer_lines_event`
+/// notification with the arguments `[buffer, changedtick, firstline,
+/// lastline, linedata]`: the lines from `firstline` up to (not including)
+/// `lastline` were replaced by `linedata`. Line numbers are zero-based and
+/// refer to the buffer contents before the change.
+///
+/// When the buffer is unloaded or the subscription is cancelled with
+/// `buffer_detach`, a `buffer_detach_event` notification is sent.
+///
+/// @param buffer The buffer handle
+/// @param send_buffer If true, the whole buffer is sent right away as a
+///        `buffer_lines_event` with `firstline` 0 and `lastline` -1
+/// @param[out] err Details of an error that may have occurred
+void buffer_attach(uint64_t channel_id,
+                   Buffer buffer,
+                   Boolean send_buffer,
+                   Error *err)
+{
+  buf_T *buf = find_buffer_by_handle(buffer, err);
+
+  if (!buf) {
+    return;
+  }
+
+  if (buf->b_ml.ml_mfp == NULL) {
+    api_set_error(err, Validation, _("Buffer is not loaded"));
+    return;
+  }
+
+  buf_updates_register(buf, channel_id, send_buffer);
+}
+
+/// Cancels a subscription made with `buffer_attach`
+///
+/// @param buffer The buffer handle
+/// @param[out] err Details of an error that may have occurred
+void buffer_detach(uint64_t channel_id, Buffer buffer, Error *err)
+{
+  buf_T *buf = find_buffer_by_handle(buffer, err);
+
+  if (!buf) {
+    return;
+  }
+
+  buf_updates_unregister(buf, channel_id);
+}
+
 /// Inserts a sequence of lines to a buffer at a certain index
 ///
 /// @param buffer The buffer handle
@@ -12,6 +12,7 @@
 #include "nvim/api/private/defs.h"
 #include "nvim/api/buffer.h"
 #include "nvim/msgpack_rpc/channel.h"
+#include "nvim/msgpack_rpc/defs.h"
 #include "nvim/vim.h"
 #include "nvim/buffer.h"
 #include "nvim/window.h"
@@ -607,6 +608,83 @@ Array vim_get_api_info(uint64_t channel_id)
   return rv;
 }
 
+/// Calls many API methods atomically.
+///
+/// The calls are executed in order within a single event loop iteration, so
+/// no other request or editor event is processed between them. All calls are
+/// validated first: if one is malformed, none is executed and a Validation
+/// error is returned. Otherwise execution stops at the first call that fails.
+///
+/// @param calls An array of calls, each one a `[method, args]` pair where
+///        `method` is the API method name and `args` its argument array
+/// @param[out] err Details of an error that may have occurred
+/// @return A two-element array. The first item is an array with the results
+///         of the calls that succeeded. The second is NIL if all calls
+///         succeeded, otherwise `[index, error_type, error_message]` for the
+///         call that failed.
+Array vim_call_atomic(uint64_t channel_id, Array calls, Error *err)
+{
+  Array rv = ARRAY_DICT_INIT;
+
+  // Validate all the calls before running any of them, so that a malformed
+  // call never leaves the earlier ones applied
+  for (size_t i = 0; i < calls.size; i++) {
+    if (calls.items[i].type != kObjectTypeArray) {
+      api_set_error(err, Validation,
+                    _("All items in calls array must be arrays"));
+      return rv;
+    }
+    Array call = calls.items[i].data.array;
+    if (call.size != 2) {
+      api_set_error(err, Validation,
+                    _("All items in calls array must be arrays of size 2"));
+      return rv;
+    }
+    if (call.items[0].type != kObjectTypeString) {
+      api_set_error(err, Validation,
+                    _("Name must be String"));
+      return rv;
+    }
+    if (call.items[1].type != kObjectTypeArray) {
+      api_set_error(err, Validation,
+                    _("Args must be Array"));
+      return rv;
+    }
+  }
+
+  Array results = ARRAY_DICT_INIT;
+  Error nested_error = ERROR_INIT;
+
+  size_t i;  // also used in the error message
+  for (i = 0; i < calls.size; i++) {
+    Array call = calls.items[i].data.array;
+    String name = call.items[0].data.string;
+    Array args = call.items[1].data.array;
+
+    MsgpackRpcRequestHandler handler = msgpack_rpc_get_handler_for(name.data,
+                                                                   name.size);
+    // The arguments are owned by the caller, handlers only borrow them. No
+    // arena is passed so results are always heap allocated.
+    Object result = handler.fn(channel_id, 0, args, NULL, &nested_error);
+    if (nested_error.set) {
+      break;
+    }
+    ADD(results, result);
+  }
+
+  ADD(rv, ARRAY_OBJ(results));
+  if (nested_error.set) {
+    Array errval = ARRAY_DICT_INIT;
+    ADD(errval, INTEGER_OBJ((Integer)i));
+    ADD(errval, INTEGER_OBJ(nested_error.type));
+    ADD(errval, STRING_OBJ(cstr_to_string(nested_error.msg)));
+    ADD(rv, ARRAY_OBJ(errval));
+  } else {
+    ADD(rv, NIL);
+  }
+  return rv;
+}
+
 /// Writes a message to vim output or error buffer. The string is split
 /// and flushed after each newline. Incomplete lines are kept for writing
 /// later.
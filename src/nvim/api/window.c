@@ -12,6 +12,8 @@
 #include "nvim/screen.h"
 #include "nvim/move.h"
 #include "nvim/misc2.h"
+#include "nvim/eval.h"
+#include "nvim/syntax.h"
 
 
 /// Gets the current buffer in a window
@@ -285,6 +287,31 @@ Tabpage window_get_tabpage(Window window, Error *err)
   return rv;
 }
 
+/// Gets the syntax pattern timing of a window, measured since ":syntime on"
+///
+/// @param window The window handle
+/// @param[out] err Details of an error that may have occurred
+/// @return An array with a dictionary for each syntax pattern, with the
+///         same items as getsyntime() returns
+Array window_get_syntime(Window window, Error *err)
+{
+  Array rv = ARRAY_DICT_INIT;
+  win_T *win = find_window_by_handle(window, err);
+
+  if (win) {
+    typval_T tv;
+    tv.v_type = VAR_LIST;
+    tv.v_lock = 0;
+    tv.vval.v_list = list_alloc();
+    ++tv.vval.v_list->lv_refcount;
+    syntime_list(win, tv.vval.v_list);
+    rv = vim_to_object(&tv).data.array;
+    clear_tv(&tv);
+  }
+
+  return rv;
+}
+
 /// Checks if a window is valid
 ///
 /// @param window The window handle
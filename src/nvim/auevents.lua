@@ -19,6 +19,7 @@ return {
     'BufWriteCmd',            -- write buffer using command
     'BufWritePost',           -- after writing a buffer
     'BufWritePre',            -- before writing a buffer
+    'BufWriteSynced',         -- after fsync() of a written buffer finished
     'CmdUndefined',           -- command undefined
     'CmdWinEnter',            -- after entering the cmdline window
     'CmdWinLeave',            -- before leaving the cmdline window
@@ -102,5 +103,6 @@ return {
     TabNewEntered=true,
     TabClosed=true,
     TermEnter=true,
+    BufWriteSynced=true,
   },
 }
@@ -33,6 +33,7 @@
 #include "nvim/ascii.h"
 #include "nvim/vim.h"
 #include "nvim/buffer.h"
+#include "nvim/buffer_updates.h"
 #include "nvim/charset.h"
 #include "nvim/cursor.h"
 #include "nvim/diff.h"
@@ -524,6 +525,7 @@ void buf_freeall(buf_T *buf, int flags)
   if (buf == curbuf && !is_curbuf)
     return;
   diff_buf_delete(buf);             /* Can't use 'diff' for unloaded buffer. */
+  buf_updates_unregister_all(buf);  // Attached channels lose the contents
   /* Remove any ownsyntax, unless exiting. */
   if (firstwin != NULL && curwin->w_buffer == buf)
     reset_synblock(curwin);
@@ -552,6 +554,7 @@ void buf_freeall(buf_T *buf, int flags)
 static void free_buffer(buf_T *buf)
 {
   handle_unregister_buffer(buf);
+  buf_updates_unregister_all(buf);
   free_buffer_stuff(buf, TRUE);
   unref_var_dict(buf->b_vars);
   aubuflocal_remove(buf);
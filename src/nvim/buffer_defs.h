@@ -28,6 +28,8 @@ typedef struct file_buffer buf_T; // Forward declaration
 #include "nvim/profile.h"
 // for String
 #include "nvim/api/private/defs.h"
+// for kvec
+#include "nvim/lib/kvec.h"
 
 #define MODIFIABLE(buf) (!buf->terminal && buf->b_p_ma)
 
@@ -429,6 +431,9 @@ typedef struct {
    * b_sst_first	pointer to first used entry in b_sst_array[] or NULL
    * b_sst_firstfree	pointer to first free entry in b_sst_array[] or NULL
    * b_sst_freecount	number of free entries in b_sst_array[]
+   * b_sst_hint	entry last found by syn_stack_find_entry() or NULL, a
+   *			starting point for searching the list
+   * b_sst_ahead_lnum	lines up to this one were parsed when idle
    * b_sst_check_lnum	entries after this lnum need to be checked for
    *			validity (MAXLNUM means no check needed)
    */
@@ -437,6 +442,8 @@ typedef struct {
   synstate_T  *b_sst_first;
   synstate_T  *b_sst_firstfree;
   int b_sst_freecount;
+  synstate_T  *b_sst_hint;
+  linenr_T b_sst_ahead_lnum;
   linenr_T b_sst_check_lnum;
   uint16_t b_sst_lasttick;      /* last display tick */
 
@@ -577,6 +584,12 @@ struct file_buffer {
   linenr_T b_u_line_lnum;       /* line number of line in u_line */
   colnr_T b_u_line_colnr;       /* optional column number */
 
+  char_u *b_u_lazy_name;        /* full name of undo file with lines not
+                                   read yet */
+  FileInfo b_u_lazy_info;       /* to check b_u_lazy_name didn't change */
+  char_u b_u_lazy_hash[UNDO_HASH_SIZE]; /* hash in b_u_lazy_name header */
+  int b_u_lazy_seq_last;        /* seq_last in b_u_lazy_name header */
+
   bool b_scanned;               /* ^N/^P have scanned this buffer */
 
   /* flags for use of ":lmap" and IM control */
@@ -757,6 +770,10 @@ struct file_buffer {
   signlist_T *b_signlist;       /* list of signs to draw */
 
   Terminal *terminal;           // Terminal instance associated with the buffer
+
+  // Channels that receive line change events for this buffer, see
+  // buffer_updates.c
+  kvec_t(uint64_t) update_channels;
 };
 
 /*
@@ -0,0 +1,149 @@
+// Line change notifications for buffers, sent to the msgpack-rpc channels
+// that attached to them with `buffer_attach`.
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nvim/buffer_updates.h"
+#include "nvim/vim.h"
+#include "nvim/api/private/helpers.h"
+#include "nvim/api/private/defs.h"
+#include "nvim/msgpack_rpc/channel.h"
+#include "nvim/memline.h"
+#include "nvim/memory.h"
+#include "nvim/lib/kvec.h"
+
+#ifdef INCLUDE_GENERATED_DECLARATIONS
+# include "buffer_updates.c.generated.h"
+#endif
+
+/// Starts sending line change events for `buf` to a channel
+///
+/// @param buf The buffer
+/// @param channel_id The channel that receives the events
+/// @param send_buffer If true, the whole buffer is sent in an initial
+///        event, so the client doesn't need to fetch it separately
+void buf_updates_register(buf_T *buf, uint64_t channel_id, bool send_buffer)
+{
+  if (!find_channel(buf, channel_id, NULL)) {
+    kv_push(uint64_t, buf->update_channels, channel_id);
+  }
+
+  if (send_buffer) {
+    Array args = ARRAY_DICT_INIT;
+    ADD(args, BUFFER_OBJ(buf->handle));
+    ADD(args, INTEGER_OBJ(buf->b_changedtick));
+    ADD(args, INTEGER_OBJ(0));
+    ADD(args, INTEGER_OBJ(-1));
+    ADD(args, ARRAY_OBJ(get_lines(buf, 1, buf->b_ml.ml_line_count)));
+    channel_send_event(channel_id, "buffer_lines_event", args);
+  }
+}
+
+/// Stops sending line change events for `buf` to a channel
+///
+/// @param buf The buffer
+/// @param channel_id The channel id
+void buf_updates_unregister(buf_T *buf, uint64_t channel_id)
+{
+  size_t i;
+  if (!find_channel(buf, channel_id, &i)) {
+    return;
+  }
+
+  kv_A(buf->update_channels, i) = kv_pop(buf->update_channels);
+  send_detach(buf, channel_id);
+}
+
+/// Detaches all channels from `buf`, called when the buffer is unloaded.
+void buf_updates_unregister_all(buf_T *buf)
+{
+  for (size_t i = 0; i < kv_size(buf->update_channels); i++) {
+    send_detach(buf, kv_A(buf->update_channels, i));
+  }
+
+  kv_destroy(buf->update_channels);
+  kv_init(buf->update_channels);
+}
+
+/// Notifies the attached channels about a change of whole lines.
+///
+/// @param buf The buffer that changed
+/// @param firstline The first changed line
+/// @param num_added Number of lines that replace the changed range
+/// @param num_removed Number of lines in the changed range
+void buf_updates_send_changes(buf_T *buf, linenr_T firstline,
+                              int64_t num_added, int64_t num_removed)
+{
+  size_t j = 0;
+
+  for (size_t i = 0; i < kv_size(buf->update_channels); i++) {
+    uint64_t channel_id = kv_A(buf->update_channels, i);
+    Array args = ARRAY_DICT_INIT;
+    ADD(args, BUFFER_OBJ(buf->handle));
+    ADD(args, INTEGER_OBJ(buf->b_changedtick));
+    ADD(args, INTEGER_OBJ(firstline - 1));
+    ADD(args, INTEGER_OBJ(firstline - 1 + num_removed));
+    ADD(args, ARRAY_OBJ(get_lines(buf, firstline,
+                                  firstline - 1 + (linenr_T)num_added)));
+
+    // Channels that went away are dropped
+    if (channel_send_event(channel_id, "buffer_lines_event", args)) {
+      kv_A(buf->update_channels, j++) = channel_id;
+    }
+  }
+
+  kv_size(buf->update_channels) = j;
+}
+
+static bool find_channel(buf_T *buf, uint64_t channel_id, size_t *idx)
+{
+  for (size_t i = 0; i < kv_size(buf->update_channels); i++) {
+    if (kv_A(buf->update_channels, i) == channel_id) {
+      if (idx) {
+        *idx = i;
+      }
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static void send_detach(buf_T *buf, uint64_t channel_id)
+{
+  Array args = ARRAY_DICT_INIT;
+  ADD(args, BUFFER_OBJ(buf->handle));
+  channel_send_event(channel_id, "buffer_detach_event", args);
+}
+
+// Copies lines `start` to `end`(inclusive) of `buf`
+static Array get_lines(buf_T *buf, linenr_T start, linenr_T end)
+{
+  Array lines = ARRAY_DICT_INIT;
+  // Autocommands triggered by the change may have reloaded the buffer
+  end = MIN(end, buf->b_ml.ml_line_count);
+
+  if (end < start) {
+    return lines;
+  }
+
+  lines.size = (size_t)(end - start + 1);
+  lines.items = xcalloc(sizeof(Object), lines.size);
+
+  MemlineIter iter;
+  ml_iter_init(&iter, buf, start, end);
+  char_u *line;
+  size_t len;
+
+  for (size_t i = 0; ml_iter_next(&iter, &line, &len); i++) {
+    String str = {
+      .data = xmemdupz(line, len),
+      .size = len
+    };
+    // Vim represents NULs as NLs, but this may confuse clients.
+    strchrsub(str.data, '\n', '\0');
+    lines.items[i] = STRING_OBJ(str);
+  }
+
+  return lines;
+}
@@ -502,6 +502,16 @@ typedef struct {
   int status;
 } JobEvent;
 
+/// Asynchronous RPC request started by rpcasync()
+typedef struct {
+  uint64_t id, channel_id;
+  ufunc_T *callback;
+  bool done, errored;
+  bool waiting;  ///< rpcwait() is blocked on this call
+  Object result;
+  Error err;
+} RpcCall;
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "eval.c.generated.h"
 #endif
@@ -511,6 +521,12 @@ typedef struct {
                                    valid character */
 static uint64_t current_job_id = 1;
 static PMap(uint64_t) *jobs = NULL; 
+static uint64_t current_rpc_call_id = 1;
+static PMap(uint64_t) *rpc_calls = NULL;
+// Results of rpcasync() calls without a callback that rpcwait() didn't
+// collect yet.  Above RPC_MAX_UNCOLLECTED the oldest one is dropped.
+static size_t rpc_uncollected = 0;
+#define RPC_MAX_UNCOLLECTED 1000
 
 typedef enum {
   kMPNil,
@@ -552,6 +568,7 @@ static const list_T *msgpack_type_lists[] = {
 void eval_init(void)
 {
   jobs = pmap_new(uint64_t)();
+  rpc_calls = pmap_new(uint64_t)();
   int i;
   struct vimvar   *p;
 
@@ -6080,6 +6097,24 @@ int dict_add_nr_str(dict_T *d, char *key, long nr, char_u *str)
   return OK;
 }
 
+/*
+ * Add a float entry to dictionary "d".
+ * Returns FAIL when key already exists.
+ */
+int dict_add_float(dict_T *d, char *key, float_T f)
+{
+  dictitem_T *item = dictitem_alloc((char_u *)key);
+
+  item->di_tv.v_lock = 0;
+  item->di_tv.v_type = VAR_FLOAT;
+  item->di_tv.vval.v_float = f;
+  if (dict_add(d, item) == FAIL) {
+    dictitem_free(item);
+    return FAIL;
+  }
+  return OK;
+}
+
 /*
  * Add a list entry to dictionary "d".
  * Returns FAIL when key already exists.
@@ -6151,14 +6186,23 @@ static bool get_dict_callback(dict_T *d, char *key, ufunc_T **result)
     *result = NULL;
     return true;
   }
-  
-  if (di->di_tv.v_type != VAR_FUNC && di->di_tv.v_type != VAR_STRING) {
+
+  return get_tv_callback(&di->di_tv, result);
+}
+
+/// Get a function from a Funcref or function name
+/// @param[out] result The address where a pointer to the wanted callback
+///                    will be left.
+/// @return true/false on success/failure.
+static bool get_tv_callback(typval_T *tv, ufunc_T **result)
+{
+  if (tv->v_type != VAR_FUNC && tv->v_type != VAR_STRING) {
     EMSG(_("Argument is not a function or function name"));
     *result = NULL;
     return false;
   }
 
-  uint8_t *name = di->di_tv.vval.v_string;
+  uint8_t *name = tv->vval.v_string;
   uint8_t *n = name;
   ufunc_T *rv = NULL;
   if (*n > '9' || *n < '0') {
@@ -6704,6 +6748,7 @@ static struct fst {
   {"getqflist",       0, 0, f_getqflist},
   {"getreg",          0, 3, f_getreg},
   {"getregtype",      0, 1, f_getregtype},
+  {"getsyntime",      0, 1, f_getsyntime},
   {"gettabvar",       2, 3, f_gettabvar},
   {"gettabwinvar",    3, 4, f_gettabwinvar},
   {"getwinposx",      0, 0, f_getwinposx},
@@ -6794,10 +6839,12 @@ static struct fst {
   {"resolve",         1, 1, f_resolve},
   {"reverse",         1, 1, f_reverse},
   {"round",           1, 1, f_round},
+  {"rpcasync",        3, 4, f_rpcasync},
   {"rpcnotify",       2, 64, f_rpcnotify},
   {"rpcrequest",      2, 64, f_rpcrequest},
   {"rpcstart",        1, 2, f_rpcstart},
   {"rpcstop",         1, 1, f_rpcstop},
+  {"rpcwait",         1, 2, f_rpcwait},
   {"screenattr",      2, 2, f_screenattr},
   {"screenchar",      2, 2, f_screenchar},
   {"screencol",       0, 0, f_screencol},
@@ -9215,9 +9262,11 @@ static void get_buffer_lines(buf_T *buf, linenr_T start, linenr_T end, int retli
       start = 1;
     if (end > buf->b_ml.ml_line_count)
       end = buf->b_ml.ml_line_count;
-    while (start <= end) {
-      list_append_string(
-        rettv->vval.v_list, ml_get_buf(buf, start++, FALSE), -1);
+    MemlineIter iter;
+    ml_iter_init(&iter, buf, start, end);
+    size_t len;
+    while (ml_iter_next(&iter, &p, &len)) {
+      list_append_string(rettv->vval.v_list, p, (int)len);
     }
   }
 }
@@ -9820,6 +9869,22 @@ static void f_getregtype(typval_T *argvars, typval_T *rettv)
   rettv->vval.v_string = vim_strsave(buf);
 }
 
+/*
+ * "getsyntime()" function
+ */
+static void f_getsyntime(typval_T *argvars, typval_T *rettv)
+{
+  win_T *wp = curwin;
+
+  if (argvars[0].v_type != VAR_UNKNOWN) {
+    wp = find_win_by_nr(&argvars[0], NULL);
+  }
+  rettv_list_alloc(rettv);
+  if (wp != NULL) {
+    syntime_list(wp, rettv->vval.v_list);
+  }
+}
+
 /*
  * "gettabvar()" function
  */
@@ -13730,6 +13795,158 @@ static void f_round(typval_T *argvars, typval_T *rettv)
   float_op_wrapper(argvars, rettv, &round);
 }
 
+// "rpcasync()" function
+static void f_rpcasync(typval_T *argvars, typval_T *rettv)
+{
+  rettv->v_type = VAR_NUMBER;
+  rettv->vval.v_number = 0;
+
+  if (check_restricted() || check_secure()) {
+    return;
+  }
+
+  if (argvars[0].v_type != VAR_NUMBER || argvars[0].vval.v_number <= 0) {
+    EMSG2(_(e_invarg2), "Channel id must be a positive integer");
+    return;
+  }
+
+  if (argvars[1].v_type != VAR_STRING) {
+    EMSG2(_(e_invarg2), "Method name must be a string");
+    return;
+  }
+
+  if (argvars[2].v_type != VAR_LIST) {
+    EMSG2(_(e_invarg2), "Arguments must be a list");
+    return;
+  }
+
+  ufunc_T *callback = NULL;
+  if (argvars[3].v_type != VAR_UNKNOWN
+      && !get_tv_callback(&argvars[3], &callback)) {
+    return;
+  }
+
+  Array args = ARRAY_DICT_INIT;
+  for (listitem_T *li = argvars[2].vval.v_list
+       ? argvars[2].vval.v_list->lv_first : NULL;
+       li != NULL; li = li->li_next) {
+    ADD(args, vim_to_object(&li->li_tv));
+  }
+
+  RpcCall *call = xcalloc(1, sizeof(RpcCall));
+  call->id = current_rpc_call_id++;
+  call->channel_id = (uint64_t)argvars[0].vval.v_number;
+  call->callback = callback;
+  pmap_put(uint64_t)(rpc_calls, call->id, call);
+
+  Error err = ERROR_INIT;
+  if (!channel_send_async_call(call->channel_id,
+                               (char *)get_tv_string(&argvars[1]),
+                               args,
+                               on_rpc_response,
+                               call,
+                               &err)) {
+    vim_report_error(cstr_as_string(err.msg));
+    free_rpc_call(call);
+    return;
+  }
+
+  rettv->vval.v_number = (varnumber_T)call->id;
+}
+
+// Response callback for rpcasync() requests. Only stores the result, the
+// VimL callback is invoked later from the main loop.
+static void on_rpc_response(uint64_t request_id, Object result, Error *err,
+    void *data)
+{
+  RpcCall *call = data;
+  call->done = true;
+  call->errored = err->set;
+  call->result = result;
+  call->err = *err;
+
+  if (call->callback) {
+    queue_put(loop.events, rpc_call_event, 1, call);
+  } else if (++rpc_uncollected > RPC_MAX_UNCOLLECTED) {
+    drop_oldest_rpc_result();
+  }
+}
+
+// Frees the oldest result of an rpcasync() call without a callback, so that
+// results that are never collected don't pile up.  A call rpcwait() is
+// blocked on is about to be collected and is never dropped.
+static void drop_oldest_rpc_result(void)
+{
+  RpcCall *oldest = NULL;
+  uint64_t id;
+  RpcCall *call;
+
+  map_foreach(rpc_calls, id, call, {
+    if (call->done && !call->callback && !call->waiting
+        && (oldest == NULL || call->id < oldest->id)) {
+      oldest = call;
+    }
+  });
+
+  if (oldest != NULL) {
+    free_rpc_call(oldest);
+  }
+}
+
+static void rpc_call_event(void **argv)
+{
+  RpcCall *call = argv[0];
+  typval_T cbargv[3];
+  int argc = call->callback->uf_args.ga_len;
+  Error err = ERROR_INIT;
+
+  if (argc > 0) {
+    cbargv[0].v_type = VAR_NUMBER;
+    cbargv[0].v_lock = 0;
+    cbargv[0].vval.v_number = (varnumber_T)call->id;
+  }
+
+  if (argc > 1) {
+    if (call->errored || !object_to_vim(call->result, &cbargv[1], &err)) {
+      cbargv[1].v_type = VAR_NUMBER;
+      cbargv[1].v_lock = 0;
+      cbargv[1].vval.v_number = 0;
+    }
+  }
+
+  if (argc > 2) {
+    char *msg = call->errored ? call->err.msg : err.set ? err.msg : "";
+    cbargv[2].v_type = VAR_STRING;
+    cbargv[2].v_lock = 0;
+    cbargv[2].vval.v_string = vim_strsave((char_u *)msg);
+  }
+
+  typval_T rettv;
+  init_tv(&rettv);
+  call_user_func(call->callback, argc, cbargv, &rettv, curwin->w_cursor.lnum,
+      curwin->w_cursor.lnum, NULL);
+  clear_tv(&rettv);
+
+  for (int i = 1; i < argc && i < 3; i++) {
+    clear_tv(&cbargv[i]);
+  }
+
+  free_rpc_call(call);
+}
+
+static void free_rpc_call(RpcCall *call)
+{
+  pmap_del(uint64_t)(rpc_calls, call->id);
+  if (call->done && !call->callback) {
+    rpc_uncollected--;
+  }
+  if (call->callback) {
+    user_func_unref(call->callback);
+  }
+  api_free_object(call->result);
+  xfree(call);
+}
+
 // "rpcnotify()" function
 static void f_rpcnotify(typval_T *argvars, typval_T *rettv)
 {
@@ -13914,6 +14131,55 @@ static void f_rpcstart(typval_T *argvars, typval_T *rettv)
   rettv->vval.v_number = (varnumber_T)channel_id;
 }
 
+// "rpcwait()" function
+static void f_rpcwait(typval_T *argvars, typval_T *rettv)
+{
+  rettv->v_type = VAR_NUMBER;
+  rettv->vval.v_number = 0;
+
+  if (check_restricted() || check_secure()) {
+    return;
+  }
+
+  if (argvars[0].v_type != VAR_NUMBER || (argvars[1].v_type != VAR_NUMBER
+        && argvars[1].v_type != VAR_UNKNOWN)) {
+    EMSG(_(e_invarg));
+    return;
+  }
+
+  RpcCall *call = pmap_get(uint64_t)(rpc_calls,
+                                     (uint64_t)argvars[0].vval.v_number);
+  if (!call || call->callback) {
+    EMSG2(_(e_invarg2), "Invalid request handle");
+    return;
+  }
+
+  int timeout = -1;
+  if (argvars[1].v_type == VAR_NUMBER && argvars[1].vval.v_number >= 0) {
+    timeout = (int)argvars[1].vval.v_number;
+  }
+
+  // Requests made by the channel while waiting must still be served
+  call->waiting = true;
+  LOOP_PROCESS_EVENTS_UNTIL(&loop, channel_get_events(call->channel_id),
+                            timeout, call->done);
+  call->waiting = false;
+
+  if (!call->done) {
+    EMSG(_("rpcwait() timed out"));
+    return;
+  }
+
+  Error err = ERROR_INIT;
+  if (call->errored) {
+    vim_report_error(cstr_as_string(call->err.msg));
+  } else if (!object_to_vim(call->result, rettv, &err)) {
+    EMSG2(_("Error converting the call result: %s"), err.msg);
+  }
+
+  free_rpc_call(call);
+}
+
 // "rpcstop()" function
 static void f_rpcstop(typval_T *argvars, typval_T *rettv)
 {
@@ -45,6 +45,7 @@
 #include <assert.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 
@@ -54,17 +55,24 @@
 #include "nvim/memory.h"
 #include "nvim/os/time.h"
 
+// Maximum number of released items kept by a parent queue for reuse
+#define QUEUE_POOL_MAX 1024
+
+typedef struct {
+  QUEUE node;
+  bool link;  // this is the parent queue link of a child queue item
+} QueueNode;
+
 typedef struct queue_item QueueItem;
 struct queue_item {
   union {
-    Queue *queue;
     struct {
       Event event;
-      QueueItem *parent;
+      QueueNode parent_link;  // node in the parent queue(child items only)
     } item;
+    QueueItem *next_free;  // next item in the pool
   } data;
-  bool link;  // this is just a link to a node in a child queue
-  QUEUE node;
+  QueueNode node;  // node in the queue the event was pushed to
 };
 
 struct queue {
@@ -72,6 +80,10 @@ struct queue {
   QUEUE headtail;
   put_callback put_cb;
   void *data;
+  // Released items, shared by the queue and its children. Queue trees are
+  // never accessed concurrently, so the pool needs no locking.
+  QueueItem *pool;
+  size_t pool_size;
 };
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
@@ -99,6 +111,8 @@ static Queue *queue_new(Queue *parent, put_callback put_cb, void *data)
   rv->parent = parent;
   rv->put_cb = put_cb;
   rv->data = data;
+  rv->pool = NULL;
+  rv->pool_size = 0;
   return rv;
 }
 
@@ -108,11 +122,21 @@ void queue_free(Queue *queue)
   while (!QUEUE_EMPTY(&queue->headtail)) {
     QUEUE *q = QUEUE_HEAD(&queue->headtail);
     QueueItem *item = queue_node_data(q);
-    if (queue->parent) {
-      QUEUE_REMOVE(&item->data.item.parent->node);
-      xfree(item->data.item.parent);
-    }
     QUEUE_REMOVE(q);
+    if (q == &item->data.item.parent_link.node) {
+      // link to an item that is still owned by a child queue
+      item->data.item.parent_link.link = false;
+      continue;
+    }
+    if (item->data.item.parent_link.link) {
+      QUEUE_REMOVE(&item->data.item.parent_link.node);
+    }
+    item_release(queue, item);
+  }
+
+  while (queue->pool) {
+    QueueItem *item = queue->pool;
+    queue->pool = item->data.next_free;
     xfree(item);
   }
 
@@ -159,50 +183,68 @@ void queue_replace_parent(Queue *queue, Queue *new_parent)
 static Event queue_remove(Queue *queue)
 {
   assert(!queue_empty(queue));
-  QUEUE *h = QUEUE_HEAD(&queue->headtail);
-  QUEUE_REMOVE(h);
-  QueueItem *item = queue_node_data(h);
-  Event rv;
-
-  if (item->link) {
-    assert(!queue->parent);
-    // remove the next node in the linked queue
-    Queue *linked = item->data.queue;
-    assert(!queue_empty(linked));
-    QueueItem *child =
-      queue_node_data(QUEUE_HEAD(&linked->headtail));
-    QUEUE_REMOVE(&child->node);
-    rv = child->data.item.event;
-    xfree(child);
-  } else {
-    if (queue->parent) {
-      // remove the corresponding link node in the parent queue
-      QUEUE_REMOVE(&item->data.item.parent->node);
-      xfree(item->data.item.parent);
-    }
-    rv = item->data.item.event;
+  // If this is a parent queue, the head may be the link node of a child queue
+  // item, in which case the item is also the head of the child queue.
+  QueueItem *item = queue_node_data(QUEUE_HEAD(&queue->headtail));
+  QUEUE_REMOVE(&item->node.node);
+  if (item->data.item.parent_link.link) {
+    QUEUE_REMOVE(&item->data.item.parent_link.node);
   }
 
-  xfree(item);
+  Event rv = item->data.item.event;
+  item_release(queue, item);
   return rv;
 }
 
 static void queue_push(Queue *queue, Event event)
 {
-  QueueItem *item = xmalloc(sizeof(QueueItem));
-  item->link = false;
+  QueueItem *item = item_alloc(queue);
   item->data.item.event = event;
-  QUEUE_INSERT_TAIL(&queue->headtail, &item->node);
+  item->node.link = false;
+  item->data.item.parent_link.link = queue->parent != NULL;
+  QUEUE_INSERT_TAIL(&queue->headtail, &item->node.node);
   if (queue->parent) {
-    // push link node to the parent queue
-    item->data.item.parent = xmalloc(sizeof(QueueItem));
-    item->data.item.parent->link = true;
-    item->data.item.parent->data.queue = queue;
-    QUEUE_INSERT_TAIL(&queue->parent->headtail, &item->data.item.parent->node);
+    // push link node to the parent queue. It is embedded in the item, so
+    // this doesn't need another allocation.
+    QUEUE_INSERT_TAIL(&queue->parent->headtail,
+                      &item->data.item.parent_link.node);
   }
 }
 
+// Returns the item that owns `q`, which may be either its own node or its
+// link node in the parent queue
 static QueueItem *queue_node_data(QUEUE *q)
 {
-  return QUEUE_DATA(q, QueueItem, node);
+  QueueNode *node = QUEUE_DATA(q, QueueNode, node);
+  if (node->link) {
+    return (QueueItem *)((char *)node
+                         - offsetof(QueueItem, data.item.parent_link));
+  }
+  return QUEUE_DATA(node, QueueItem, node);
+}
+
+// Gets an item from the pool of the queue tree, or allocates a new one
+static QueueItem *item_alloc(Queue *queue)
+{
+  Queue *root = queue->parent ? queue->parent : queue;
+  QueueItem *item = root->pool;
+  if (item) {
+    root->pool = item->data.next_free;
+    root->pool_size--;
+    return item;
+  }
+  return xmalloc(sizeof(QueueItem));
+}
+
+// Returns an item to the pool of the queue tree
+static void item_release(Queue *queue, QueueItem *item)
+{
+  Queue *root = queue->parent ? queue->parent : queue;
+  if (root->pool_size >= QUEUE_POOL_MAX) {
+    xfree(item);
+    return;
+  }
+  item->data.next_free = root->pool;
+  root->pool = item;
+  root->pool_size++;
 }
@@ -64,6 +64,9 @@ void stream_init(Loop *loop, Stream *stream, int fd, uv_stream_t *uvstream,
   stream->curmem = 0;
   stream->maxmem = 0;
   stream->pending_reqs = 0;
+  kv_init(stream->wqueue);
+  stream->wqueue_size = 0;
+  stream->hwm = 0;
   stream->read_cb = NULL;
   stream->write_cb = NULL;
   stream->close_cb = NULL;
@@ -98,6 +101,9 @@ void stream_close_handle(Stream *stream)
 static void close_cb(uv_handle_t *handle)
 {
   Stream *stream = handle->data;
+  // Queued writes are always flushed before the handle is closed
+  assert(!kv_size(stream->wqueue));
+  kv_destroy(stream->wqueue);
   if (stream->buffer) {
     rbuffer_free(stream->buffer);
   }
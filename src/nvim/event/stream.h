@@ -8,6 +8,7 @@
 
 #include "nvim/event/loop.h"
 #include "nvim/rbuffer.h"
+#include "nvim/lib/kvec.h"
 
 typedef struct stream Stream;
 /// Type of function called when the Stream buffer is filled with data
@@ -49,6 +50,11 @@ struct stream {
   size_t curmem;
   size_t maxmem;
   size_t pending_reqs;
+  // Buffers queued by `wstream_write` while a write request is in flight.
+  // They are flushed together as a single vectored write.
+  kvec_t(struct wbuffer *) wqueue;
+  size_t wqueue_size;  // total bytes in `wqueue`
+  size_t hwm;  // flush `wqueue` immediately once it holds this many bytes
   void *data, *internal_data;
   bool closed;
   Queue *events;
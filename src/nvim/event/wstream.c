@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <uv.h>
 
@@ -11,11 +12,14 @@
 #include "nvim/memory.h"
 
 #define DEFAULT_MAXMEM 1024 * 1024 * 10
+#define DEFAULT_HWM (1024 * 64)
+#define WRITE_STACK_BUFS 16
 
 typedef struct {
   Stream *stream;
-  WBuffer *buffer;
   uv_write_t uv_req;
+  size_t size, count;
+  WBuffer *buffers[];
 } WRequest;
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
@@ -41,10 +45,26 @@ void wstream_init_stream(Stream *stream, uv_stream_t *uvstream, size_t maxmem,
 void wstream_init(Stream *stream, size_t maxmem)
 {
   stream->maxmem = maxmem ? maxmem : DEFAULT_MAXMEM;
+  stream->hwm = DEFAULT_HWM;
+}
+
+/// Sets the high-water mark for write coalescing.
+///
+/// While a write request is in flight, buffers passed to `wstream_write` are
+/// queued and later flushed together as a single vectored write. Once the
+/// queue holds `hwm` bytes it is flushed right away instead.
+///
+/// @param stream The `Stream` instance
+/// @param hwm Queue size in bytes. 0 disables coalescing.
+void wstream_set_hwm(Stream *stream, size_t hwm)
+  FUNC_ATTR_NONNULL_ALL
+{
+  stream->hwm = hwm;
 }
 
 /// Sets a callback that will be called on completion of a write request,
-/// indicating failure/success.
+/// indicating failure/success. Since queued buffers are coalesced, one
+/// request may cover several `wstream_write` calls.
 ///
 /// This affects all requests currently in-flight as well. Overwrites any
 /// possible earlier callback.
@@ -64,6 +84,10 @@ void wstream_set_write_cb(Stream *stream, stream_write_cb cb)
 /// instance. This will fail if the write would cause the Stream use more
 /// memory than specified by `maxmem`.
 ///
+/// If no write request is in flight the data is written immediately,
+/// otherwise it is queued and flushed with the other queued buffers when the
+/// current request completes (or when the high-water mark is reached).
+///
 /// @param stream The `Stream` instance
 /// @param buffer The buffer which contains data to be written
 /// @return false if the write failed
@@ -75,31 +99,19 @@ bool wstream_write(Stream *stream, WBuffer *buffer)
   assert(!stream->closed);
 
   if (stream->curmem > stream->maxmem) {
-    goto err;
+    wstream_release_wbuffer(buffer);
+    return false;
   }
 
   stream->curmem += buffer->size;
+  kv_push(WBuffer *, stream->wqueue, buffer);
+  stream->wqueue_size += buffer->size;
 
-  WRequest *data = xmalloc(sizeof(WRequest));
-  data->stream = stream;
-  data->buffer = buffer;
-  data->uv_req.data = data;
-
-  uv_buf_t uvbuf;
-  uvbuf.base = buffer->data;
-  uvbuf.len = buffer->size;
-
-  if (uv_write(&data->uv_req, stream->uvstream, &uvbuf, 1, write_cb)) {
-    xfree(data);
-    goto err;
+  if (stream->pending_reqs && stream->wqueue_size < stream->hwm) {
+    return true;
   }
 
-  stream->pending_reqs++;
-  return true;
-
-err:
-  wstream_release_wbuffer(buffer);
-  return false;
+  return flush(stream);
 }
 
 /// Creates a WBuffer object for holding output data. Instances of this
@@ -129,26 +141,76 @@ WBuffer *wstream_new_buffer(char *data,
   return rv;
 }
 
+// Writes all queued buffers with a single `uv_write` call.
+static bool flush(Stream *stream)
+{
+  size_t count = kv_size(stream->wqueue);
+  assert(count);
+  WRequest *data = xmalloc(sizeof(WRequest) + count * sizeof(WBuffer *));
+  data->stream = stream;
+  data->size = stream->wqueue_size;
+  data->count = count;
+  data->uv_req.data = data;
+  memcpy(data->buffers, stream->wqueue.items, count * sizeof(WBuffer *));
+  kv_size(stream->wqueue) = 0;
+  stream->wqueue_size = 0;
+
+  // uv_write copies the uv_buf_t array, so it only has to outlive the call
+  uv_buf_t stack_bufs[WRITE_STACK_BUFS];
+  uv_buf_t *bufs = count <= WRITE_STACK_BUFS
+                   ? stack_bufs : xmalloc(count * sizeof(uv_buf_t));
+  for (size_t i = 0; i < count; i++) {
+    bufs[i].base = data->buffers[i]->data;
+    bufs[i].len = data->buffers[i]->size;
+  }
+
+  int err = uv_write(&data->uv_req, stream->uvstream, bufs, (unsigned)count,
+      write_cb);
+
+  if (bufs != stack_bufs) {
+    xfree(bufs);
+  }
+
+  if (err) {
+    release_request(data);
+    return false;
+  }
+
+  stream->pending_reqs++;
+  return true;
+}
+
+static void release_request(WRequest *data)
+{
+  data->stream->curmem -= data->size;
+  for (size_t i = 0; i < data->count; i++) {
+    wstream_release_wbuffer(data->buffers[i]);
+  }
+  xfree(data);
+}
+
 static void write_cb(uv_write_t *req, int status)
 {
   WRequest *data = req->data;
+  Stream *stream = data->stream;
 
-  data->stream->curmem -= data->buffer->size;
-
-  wstream_release_wbuffer(data->buffer);
+  release_request(data);
 
-  if (data->stream->write_cb) {
-    data->stream->write_cb(data->stream, data->stream->data, status);
+  if (stream->write_cb) {
+    stream->write_cb(stream, stream->data, status);
   }
 
-  data->stream->pending_reqs--;
+  stream->pending_reqs--;
 
-  if (data->stream->closed && data->stream->pending_reqs == 0) {
-    // Last pending write, free the stream;
-    stream_close_handle(data->stream);
+  if (kv_size(stream->wqueue)) {
+    // Write everything that was queued while this request was in flight
+    flush(stream);
   }
 
-  xfree(data);
+  if (stream->closed && stream->pending_reqs == 0) {
+    // Last pending write, free the stream;
+    stream_close_handle(stream);
+  }
 }
 
 void wstream_release_wbuffer(WBuffer *buffer)
@@ -6174,6 +6174,8 @@ void alist_slash_adjust(void)
 static void ex_preserve(exarg_T *eap)
 {
   curbuf->b_flags |= BF_PRESERVED;
+  // Write fewer, fuller blocks.
+  ml_compact(curbuf);
   ml_preserve(curbuf, TRUE);
 }
 
@@ -65,8 +65,20 @@
 # include <utime.h>             /* for struct utimbuf */
 #endif
 
+// A big file is read through a memory mapping when SIGBUS can be caught, the
+// file may be truncated while reading it.
+#if defined(HAVE_MMAP) && defined(HAVE_SIGACTION)
+# define READ_MAPPED
+# include <setjmp.h>
+# include <signal.h>
+# include <sys/mman.h>
+#endif
+
 #define BUFSIZE         8192    /* size of normal write buffer */
+#define BIGBUFSIZE      (256 * 1024)  /* write buffer when not converting */
 #define SMBUFSIZE       256     /* size of emergency write buffer */
+#define MAP_RELEASE_SIZE (16 * 1024 * 1024)  /* mapped bytes released at once
+                                                 by readfile_mapped() */
 
 /*
  * The autocommands are stored in a list for each event.
@@ -160,6 +172,19 @@ typedef struct AutoPatCmd {
  * with iconv() to be able to allocate a buffer. */
 #define ICONV_MULT 8
 
+/// A file written by buf_write() that is synced in the background.
+typedef struct {
+  uv_fs_t req;
+  int fd;
+  int bufnr;                    ///< buffer that was written
+  char_u *fname;                ///< name of the written file
+  char_u *backup;               ///< backup to remove after syncing or NULL
+  bool backup_failed;           ///< removing the backup failed
+} WriteSync;
+
+/// Number of files that are being synced in the background.
+static int pending_syncs = 0;
+
 /*
  * Structure to pass arguments from buf_write() to buf_write_bytes().
  */
@@ -328,6 +353,7 @@ readfile (
                                            'charconvert' next */
 # endif
   int converted = FALSE;                /* TRUE if conversion done */
+  bool read_mapped = false;             /* file was read from a mapping */
   int notconverted = FALSE;             /* TRUE if conversion wanted but it
                                            wasn't possible */
   char_u conv_rest[CONV_RESTLEN];
@@ -999,7 +1025,65 @@ retry:
       sha256_start(&sha_ctx);
   }
 
-  while (!error && !got_int) {
+#ifdef READ_MAPPED
+  /*
+   * A big file that doesn't need conversion is read through a memory
+   * mapping, the lines are appended without going through "buffer".
+   */
+  char_u *mapped;
+  size_t mapped_size;
+  int mapped_ff = fileformat;
+  if (!skip_read && !converted && !read_stdin && !read_buffer && !filtering
+      && lines_to_skip == 0 && lines_to_read == MAXLNUM
+      && (mapped = readfile_map(fd, &mapped_size, &mapped_ff, try_dos,
+                                &try_unix, &try_mac)) != NULL) {
+    if (fileformat == EOL_UNKNOWN) {
+      fileformat = mapped_ff;
+      if (set_options) {
+        set_fileformat(fileformat, OPT_LOCAL);
+      }
+    }
+
+    if (fileformat == EOL_MAC) {
+      munmap(mapped, mapped_size);
+    } else {
+      if (p_verbose > 0) {
+        verbose_enter();
+        smsg(_("Reading through a memory mapping: %s"), fname);
+        verbose_leave();
+      }
+      bool no_eol = false;
+      int r = readfile_mapped(mapped, mapped_size, fileformat, try_unix,
+                              &lnum, newfile,
+                              read_undo_file ? &sha_ctx : NULL,
+                              &no_eol, &ff_error, &split);
+      munmap(mapped, mapped_size);
+      if (r == NOTDONE) {
+        // Reading in Dos format, but no CR-LF found: start all over again
+        // in Unix format.
+        fileformat = EOL_UNIX;
+        if (set_options)
+          set_fileformat(EOL_UNIX, OPT_LOCAL);
+        file_rewind = TRUE;
+        keep_fileformat = TRUE;
+        goto retry;
+      }
+      if (r == FAIL) {
+        error = TRUE;
+      }
+      if (no_eol) {
+        /* remember for when writing */
+        if (set_options)
+          curbuf->b_p_eol = FALSE;
+        read_no_eol_lnum = lnum;
+      }
+      filesize = (off_t)mapped_size;
+      read_mapped = true;
+    }
+  }
+#endif
+
+  while (!read_mapped && !error && !got_int) {
     /*
      * We allocate as much space for the file as we can get, plus
      * space for the old line plus room for one terminating NUL.
@@ -1526,6 +1610,9 @@ retry:
                 *p = bad_char_behavior;
             } else
               p += l - 1;
+          } else {
+            /* Skip over a run of ASCII bytes at once. */
+            p += ascii_prefix_len(p, (size_t)todo) - 1;
           }
         }
         if (p < ptr + size && !incomplete_tail) {
@@ -1552,47 +1639,8 @@ rewind_retry:
        * when reading the first part of a file: guess EOL type
        */
       if (fileformat == EOL_UNKNOWN) {
-        /* First try finding a NL, for Dos and Unix */
-        if (try_dos || try_unix) {
-          for (p = ptr; p < ptr + size; ++p) {
-            if (*p == NL) {
-              if (!try_unix
-                  || (try_dos && p > ptr && p[-1] == CAR))
-                fileformat = EOL_DOS;
-              else
-                fileformat = EOL_UNIX;
-              break;
-            }
-          }
-
-          /* Don't give in to EOL_UNIX if EOL_MAC is more likely */
-          if (fileformat == EOL_UNIX && try_mac) {
-            /* Need to reset the counters when retrying fenc. */
-            try_mac = 1;
-            try_unix = 1;
-            for (; p >= ptr && *p != CAR; p--)
-              ;
-            if (p >= ptr) {
-              for (p = ptr; p < ptr + size; ++p) {
-                if (*p == NL)
-                  try_unix++;
-                else if (*p == CAR)
-                  try_mac++;
-              }
-              if (try_mac > try_unix)
-                fileformat = EOL_MAC;
-            }
-          }
-        }
-
-        /* No NL found: may use Mac format */
-        if (fileformat == EOL_UNKNOWN && try_mac)
-          fileformat = EOL_MAC;
-
-        /* Still nothing found?  Use first format in 'ffs' */
-        if (fileformat == EOL_UNKNOWN)
-          fileformat = default_fileformat();
-
+        fileformat = detect_fileformat(ptr, size, try_dos, &try_unix,
+                                       &try_mac);
         // May set 'p_ff' if editing a new file.
         if (set_options) {
           set_fileformat(fileformat, OPT_LOCAL);
@@ -1638,8 +1686,13 @@ rewind_retry:
     } else {
       --ptr;
       while (++ptr, --size >= 0) {
-        if ((c = *ptr) != NUL && c != NL)          /* catch most common case */
+        if ((c = *ptr) != NUL && c != NL) {        /* catch most common case */
+          /* Skip to the next NL or NUL at once. */
+          char_u *next = find_nl_or_nul(ptr + 1, ptr + 1 + size);
+          size -= next - ptr - 1;
+          ptr = next - 1;
           continue;
+        }
         if (c == NUL)
           *ptr = NL;            /* NULs are replaced by newlines! */
         else {
@@ -1773,7 +1826,10 @@ failed:
   if (!recoverymode) {
     /* need to delete the last line, which comes from the empty buffer */
     if (newfile && wasempty && !(curbuf->b_ml.ml_flags & ML_EMPTY)) {
+      // Not a reason to compact the memline.
+      long freed = curbuf->b_ml.ml_freed;
       ml_delete(curbuf->b_ml.ml_line_count, FALSE);
+      curbuf->b_ml.ml_freed = freed;
       --linecnt;
     }
     linecnt = curbuf->b_ml.ml_line_count - linecnt;
@@ -2008,6 +2064,409 @@ static int is_dev_fd_file(char_u *fname)
 #endif
 
 
+/// Syncs and closes file descriptor "fd" of a file written by buf_write() on
+/// a worker thread.
+///
+/// Afterwards "backup" is removed, unless syncing failed, and the
+/// BufWriteSynced autocommands are triggered.  Takes ownership of "backup".
+static void write_sync_start(buf_T *buf, int fd, char_u *fname,
+                             char_u *backup)
+{
+  WriteSync *ws = xmalloc(sizeof(WriteSync));
+  ws->req.data = ws;
+  ws->fd = fd;
+  ws->bufnr = buf->b_fnum;
+  ws->fname = vim_strsave(fname);
+  ws->backup = backup;
+  ws->backup_failed = false;
+  pending_syncs++;
+
+  int r = uv_fs_fsync(&loop.uv, &ws->req, fd, write_sync_cb);
+  if (r < 0) {
+    // Could not queue the request, sync right away
+    ws->req.result = fsync(fd) == 0 ? 0 : -errno;
+    write_sync_cb(&ws->req);
+  }
+}
+
+// Runs on the main thread when the fsync() has finished.  Only does what
+// doesn't need the editor state, so that it is complete even when exiting,
+// the rest is done by write_sync_event().
+static void write_sync_cb(uv_fs_t *req)
+{
+  WriteSync *ws = req->data;
+
+  close(ws->fd);
+  if (req->result >= 0 && ws->backup != NULL
+      && os_remove((char *)ws->backup) != 0) {
+    ws->backup_failed = true;
+  }
+  pending_syncs--;
+  queue_put(loop.events, write_sync_event, 1, ws);
+}
+
+static void write_sync_event(void **argv)
+{
+  WriteSync *ws = argv[0];
+
+  if (ws->req.result < 0) {
+    EMSG3(_("E667: Fsync failed for \"%s\": %s"), ws->fname,
+          uv_strerror((int)ws->req.result));
+  } else if (ws->backup_failed) {
+    EMSG(_("E207: Can't delete backup file"));
+  }
+  apply_autocmds(EVENT_BUFWRITESYNCED, ws->fname, ws->fname, FALSE,
+                 buflist_findnr(ws->bufnr));
+
+  uv_fs_req_cleanup(&ws->req);
+  xfree(ws->fname);
+  xfree(ws->backup);
+  xfree(ws);
+}
+
+/// Waits until the files written with 'asyncfsync' have been synced.
+///
+/// The BufWriteSynced autocommands are not triggered, used when exiting.
+void write_sync_wait(void)
+{
+  LOOP_PROCESS_EVENTS_UNTIL(&loop, NULL, -1, pending_syncs == 0);
+}
+
+/// Copies "len" bytes of text of a line to "dest" the way they are written:
+/// a NL stands for a NUL in the buffer and for the Mac format a CR is written
+/// as a NL.
+static void copy_line_text(char_u *dest, const char_u *src, size_t len,
+                           int fileformat)
+{
+  char_u *end = dest + len;
+  char_u *p;
+
+  memcpy(dest, src, len);
+  for (p = dest; (p = memchr(p, NL, (size_t)(end - p))) != NULL; p++) {
+    *p = NUL;                           /* replace newlines with NULs */
+  }
+  if (fileformat == EOL_MAC) {
+    for (p = dest; (p = memchr(p, CAR, (size_t)(end - p))) != NULL; p++) {
+      *p = NL;                          /* Mac: replace CRs with NLs */
+    }
+  }
+}
+
+/// Returns the number of ASCII bytes at the start of "p[len]".
+static size_t ascii_prefix_len(const char_u *p, size_t len)
+{
+  size_t i = 0;
+
+  // Check a word at a time while no byte has the high bit set
+  while (i + sizeof(uint64_t) <= len) {
+    uint64_t w;
+    memcpy(&w, p + i, sizeof(w));
+    if (w & 0x8080808080808080ULL) {
+      break;
+    }
+    i += sizeof(w);
+  }
+  while (i < len && p[i] < 0x80) {
+    i++;
+  }
+  return i;
+}
+
+/// Returns a pointer to the first NL or NUL in "p[]" before "end", or "end"
+/// when there is none.  Uses memchr(), which is vectorized by the C library.
+static char_u *find_nl_or_nul(char_u *p, char_u *end)
+{
+  char_u *nl = memchr(p, NL, (size_t)(end - p));
+  if (nl == NULL) {
+    nl = end;
+  }
+  char_u *nul = memchr(p, NUL, (size_t)(nl - p));
+  return nul != NULL ? nul : nl;
+}
+
+/// Guesses the end-of-line format of a file from its first "size" bytes.
+///
+/// "try_dos", "try_unix" and "try_mac" tell which formats are in
+/// 'fileformats'. "try_unix" and "try_mac" are used as counters when both
+/// Unix and Mac line endings are found.
+///
+/// @return EOL_UNIX, EOL_DOS or EOL_MAC.
+static int detect_fileformat(char_u *ptr, long size, int try_dos,
+                             int *try_unix, int *try_mac)
+{
+  int fileformat = EOL_UNKNOWN;
+  char_u *p;
+
+  /* First try finding a NL, for Dos and Unix */
+  if (try_dos || *try_unix) {
+    for (p = ptr; p < ptr + size; ++p) {
+      if (*p == NL) {
+        if (!*try_unix
+            || (try_dos && p > ptr && p[-1] == CAR))
+          fileformat = EOL_DOS;
+        else
+          fileformat = EOL_UNIX;
+        break;
+      }
+    }
+
+    /* Don't give in to EOL_UNIX if EOL_MAC is more likely */
+    if (fileformat == EOL_UNIX && *try_mac) {
+      /* Need to reset the counters when retrying fenc. */
+      *try_mac = 1;
+      *try_unix = 1;
+      for (; p >= ptr && *p != CAR; p--)
+        ;
+      if (p >= ptr) {
+        for (p = ptr; p < ptr + size; ++p) {
+          if (*p == NL)
+            (*try_unix)++;
+          else if (*p == CAR)
+            (*try_mac)++;
+        }
+        if (*try_mac > *try_unix)
+          fileformat = EOL_MAC;
+      }
+    }
+  }
+
+  /* No NL found: may use Mac format */
+  if (fileformat == EOL_UNKNOWN && *try_mac)
+    fileformat = EOL_MAC;
+
+  /* Still nothing found?  Use first format in 'ffs' */
+  if (fileformat == EOL_UNKNOWN)
+    fileformat = default_fileformat();
+
+  return fileformat;
+}
+
+#ifdef READ_MAPPED
+static sigjmp_buf mapped_jmp;               // where SIGBUS jumps to
+static volatile sig_atomic_t mapped_guarded = false;  // mapped_jmp is valid
+
+static struct sigaction mapped_old_sa;      // SIGBUS action to restore
+
+/// SIGBUS handler used while reading from a mapped file.
+static void mapped_sigbus(int sig)
+{
+  if (!mapped_guarded) {
+    // Not caused by reading the mapping, handle it as usual.
+    signal(sig, SIG_DFL);
+    raise(sig);
+    return;
+  }
+  mapped_guarded = false;
+  siglongjmp(mapped_jmp, 1);
+}
+
+/// Installs mapped_sigbus() for SIGBUS.  Reading the mapped file must be done
+/// with "mapped_guarded" set after sigsetjmp(mapped_jmp).
+static void mapped_catch_sigbus(void)
+{
+  struct sigaction sa;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_handler = mapped_sigbus;
+  sa.sa_flags = SA_NODEFER;  // siglongjmp() doesn't restore the signal mask
+  sigaction(SIGBUS, &sa, &mapped_old_sa);
+}
+
+/// Restores the SIGBUS action that mapped_catch_sigbus() replaced.
+static void mapped_restore_sigbus(void)
+{
+  mapped_guarded = false;
+  sigaction(SIGBUS, &mapped_old_sa, NULL);
+}
+
+/// Checks that "size" bytes at "p" are valid UTF-8.
+static bool utf8_valid(const char_u *p, size_t size)
+{
+  const char_u *end = p + size;
+
+  while (p < end) {
+    if (*p < 0x80) {
+      p += ascii_prefix_len(p, (size_t)(end - p));
+      continue;
+    }
+    int todo = (int)MIN(end - p, 8);
+    int l = utf_ptr2len_len(p, todo);
+    if (l == 1 || l > todo) {
+      return false;
+    }
+    p += l;
+  }
+  return true;
+}
+
+/// Maps file "fd" into memory for readfile(), if it is worth it.
+///
+/// Only regular files of at least 'mmapsize' Kbyte are mapped. Files that
+/// start with a BOM or, when 'encoding' is utf-8, contain illegal bytes are
+/// not mapped, the normal read loop deals with those.  Neither are files
+/// truncated while checking them.
+///
+/// @param[out] sizep  Size of the mapping.
+/// @param[in,out] fileformatp  When EOL_UNKNOWN, set to the detected format.
+/// @return the mapped file or NULL.
+static char_u *readfile_map(int fd, size_t *sizep, int *fileformatp,
+                            int try_dos, int *try_unix, int *try_mac)
+{
+  FileInfo file_info;
+  if (p_mms <= 0 || !os_fileinfo_fd(fd, &file_info)
+      || !S_ISREG(file_info.stat.st_mode)) {
+    return NULL;
+  }
+
+  uint64_t size = os_fileinfo_size(&file_info);
+  if (size < (uint64_t)p_mms * 1024 || size > SIZE_MAX) {
+    return NULL;
+  }
+
+  char_u *data = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+
+  mapped_catch_sigbus();
+  if (sigsetjmp(mapped_jmp, 0) != 0) {
+    // The file was truncated, let the read loop read what is left.
+    mapped_restore_sigbus();
+    munmap(data, (size_t)size);
+    return NULL;
+  }
+  mapped_guarded = true;
+
+  int blen;
+  if (check_for_bom(data, (long)MIN(size, 4), &blen, FIO_ALL) != NULL
+      || (enc_utf8 && !curbuf->b_p_bin
+          && !utf8_valid(data, (size_t)size))) {
+    mapped_restore_sigbus();
+    munmap(data, (size_t)size);
+    return NULL;
+  }
+  if (*fileformatp == EOL_UNKNOWN) {
+    *fileformatp = detect_fileformat(data, (long)MIN(size, 0x10000), try_dos,
+                                     try_unix, try_mac);
+  }
+  mapped_restore_sigbus();
+
+  (void)madvise(data, (size_t)size, MADV_SEQUENTIAL);
+  *sizep = (size_t)size;
+  return data;
+}
+
+/// Appends the lines of a mapped file after line "*lnump" of curbuf.
+///
+/// Each line is copied out of the mapping with SIGBUS caught: when the file
+/// is truncated while reading it, accessing the pages beyond the end raises
+/// SIGBUS.  The copy is then passed to ml_append().
+///
+/// @param fileformat  EOL_UNIX or EOL_DOS.
+/// @param dos_retry   For EOL_DOS, give up when a line has no CR.
+/// @param sha_ctx     When not NULL, the text is added to the undo file hash.
+/// @param[out] no_eol    Set when the last line has no end-of-line.
+/// @param[out] ff_error  Set to EOL_DOS when a line has no CR.
+/// @param[out] split     Incremented for each line split for being too long.
+/// @return OK, FAIL when appending failed or the file was truncated, NOTDONE
+///         when "dos_retry" is set and a line without CR was found.
+static int readfile_mapped(char_u *data, size_t size, int fileformat,
+                           bool dos_retry, linenr_T *lnump, int newfile,
+                           context_sha256_T *sha_ctx, bool *no_eol,
+                           int *ff_error, int *split)
+{
+  char_u *end = data + size;
+  char_u *line_start = data;
+  char_u *released = data;      // start of pages not released yet
+  // Copy of the line, volatile because it is used after siglongjmp().
+  char_u *volatile line = NULL;
+  size_t line_size = 0;
+  int retval = OK;
+
+  mapped_catch_sigbus();
+  while (line_start < end && !got_int) {
+    if (sigsetjmp(mapped_jmp, 0) != 0) {
+      // The file was truncated while reading it.
+      retval = FAIL;
+      break;
+    }
+    mapped_guarded = true;
+
+    char_u *eol = memchr(line_start, NL, (size_t)(end - line_start));
+    if (eol == NULL) {
+      // Last line without a NL.  In Dos format ignore a trailing CTRL-Z,
+      // unless 'binary' set.
+      if (!curbuf->b_p_bin && fileformat == EOL_DOS
+          && *line_start == Ctrl_Z && line_start + 1 == end) {
+        break;
+      }
+      *no_eol = true;
+      eol = end;
+    }
+
+    size_t len = (size_t)(eol - line_start);
+    if (eol < end && fileformat == EOL_DOS) {
+      if (len > 0 && line_start[len - 1] == CAR) {
+        len--;                          // remove CR
+      } else if (*ff_error != EOL_DOS) {
+        // Reading in Dos format, but no CR-LF found!
+        if (dos_retry) {
+          retval = NOTDONE;
+          break;
+        }
+        *ff_error = EOL_DOS;
+      }
+    }
+    char_u *next = eol + 1;
+    if (len >= MAXCOL) {
+      // Line too long, split it.  The rest is read as the next line.
+      len = MAXCOL - 1;
+      next = line_start + len;
+      ++*split;
+    }
+
+    if (len + 1 > line_size) {
+      mapped_guarded = false;
+      line_size = len + 1;
+      line = xrealloc(line, line_size);
+      mapped_guarded = true;
+    }
+    memcpy(line, line_start, len);
+    mapped_guarded = false;
+    line[len] = NUL;
+
+    // NULs are replaced by newlines!
+    for (char_u *p = line; (p = memchr(p, NUL, (size_t)(line + len - p)))
+         != NULL; p++) {
+      *p = NL;
+    }
+
+    if (ml_append(*lnump, line, (colnr_T)len + 1, newfile) == FAIL) {
+      retval = FAIL;
+      break;
+    }
+    if (sha_ctx != NULL) {
+      sha256_update(sha_ctx, line, len);
+      sha256_update(sha_ctx, (char_u *)"", 1);
+    }
+    ++*lnump;
+    line_start = next;
+
+    // Don't keep the whole file in memory, the text has been copied into
+    // the memline.
+    if (line_start - released >= MAP_RELEASE_SIZE) {
+      size_t n = (size_t)(line_start - released) & ~(MAP_RELEASE_SIZE - 1);
+      (void)madvise(released, n, MADV_DONTNEED);
+      released += n;
+      os_breakcheck();
+    }
+  }
+
+  mapped_restore_sigbus();
+  xfree(line);
+  return retval;
+}
+#endif
+
 /*
  * From the current line count and characters read after that, estimate the
  * line number where we are now.
@@ -2281,6 +2740,7 @@ buf_write (
   struct bw_info write_info;            /* info for buf_write_bytes() */
   int converted = FALSE;
   int notconverted = FALSE;
+  bool sync_later = false;              /* fsync() on a worker thread */
   char_u          *fenc;                /* effective 'fileencoding' */
   char_u          *fenc_tofree = NULL;   /* allocated "fenc" */
 #ifdef HAS_BW_FLAGS
@@ -3250,6 +3710,22 @@ restore_backup:
   errmsg = NULL;
 
 
+  /* Without conversion the text is written as it is, use a big buffer to
+   * reduce the number of write() calls.  Conversion buffers have been
+   * allocated for "bufsize" already. */
+  if (wb_flags == 0
+# ifdef USE_ICONV
+      && write_info.bw_iconv_fd == (iconv_t)-1
+# endif
+      && buffer != smallbuf) {
+    char_u *bigbuf = try_malloc(BIGBUFSIZE);
+    if (bigbuf != NULL) {
+      xfree(buffer);
+      buffer = bigbuf;
+      bufsize = BIGBUFSIZE;
+    }
+  }
+
   write_info.bw_fd = fd;
   write_info.bw_buf = buffer;
   nchars = 0;
@@ -3290,23 +3766,26 @@ restore_backup:
   fileformat = get_fileformat_force(buf, eap);
   s = buffer;
   len = 0;
+  MemlineIter iter;
+  ml_iter_init(&iter, buf, start, end);
   for (lnum = start; lnum <= end; ++lnum) {
+    size_t line_len;
+    if (!ml_iter_next(&iter, &ptr, &line_len)) {
+      break;
+    }
+    if (write_undo_file)
+      sha256_update(&sha_ctx, ptr, line_len + 1);
     /*
-     * The next while loop is done once for each character written.
-     * Keep it fast!
+     * The text of the line is copied to the buffer in as few pieces as
+     * possible, a piece ends when the buffer is full.
      */
-    ptr = ml_get_buf(buf, lnum, FALSE) - 1;
-    if (write_undo_file)
-      sha256_update(&sha_ctx, ptr + 1, (uint32_t)(STRLEN(ptr + 1) + 1));
-    while ((c = *++ptr) != NUL) {
-      if (c == NL)
-        *s = NUL;                       /* replace newlines with NULs */
-      else if (c == CAR && fileformat == EOL_MAC)
-        *s = NL;                        /* Mac: replace CRs with NLs */
-      else
-        *s = c;
-      ++s;
-      if (++len != bufsize)
+    while (line_len > 0) {
+      size_t n = MIN(line_len, (size_t)(bufsize - len));
+      copy_line_text(s, ptr, n, fileformat);
+      s += n;
+      ptr += n;
+      line_len -= n;
+      if ((len += (int)n) != bufsize)
         continue;
       if (buf_write_bytes(&write_info) == FAIL) {
         end = 0;                        /* write error: break loop */
@@ -3376,7 +3855,11 @@ restore_backup:
    * For a device do try the fsync() but don't complain if it does not work
    * (could be a pipe).
    * If the 'fsync' option is FALSE, don't fsync().  Useful for laptops. */
-  if (p_fs && fsync(fd) != 0 && !device) {
+  /* With 'asyncfsync' the file is synced on a worker thread once it has
+   * been written completely, see write_sync_start(). */
+  if (p_fs && p_afs && !device && wfname == fname && end != 0) {
+    sync_later = true;
+  } else if (p_fs && fsync(fd) != 0 && !device) {
     errmsg = (char_u *)_("E667: Fsync failed");
     end = 0;
   }
@@ -3409,7 +3892,7 @@ restore_backup:
   }
 #endif
 
-  if (close(fd) != 0) {
+  if (!sync_later && close(fd) != 0) {
     errmsg = (char_u *)_("E512: Close failed");
     end = 0;
   }
@@ -3631,9 +4114,14 @@ restore_backup:
   }
 
   /*
-   * Remove the backup unless 'backup' option is set
+   * Remove the backup unless 'backup' option is set.  When syncing in the
+   * background that is done after the file has been synced.
    */
-  if (!p_bk && backup != NULL && os_remove((char *)backup) != 0)
+  if (sync_later) {
+    write_sync_start(buf, fd, sfname, p_bk ? NULL : backup);
+    if (!p_bk)
+      backup = NULL;
+  } else if (!p_bk && backup != NULL && os_remove((char *)backup) != 0)
     EMSG(_("E207: Can't delete backup file"));
 
 
@@ -803,6 +803,9 @@ void getout(int exitval)
     apply_autocmds(EVENT_VIMLEAVEPRE, NULL, NULL, FALSE, curbuf);
   }
 
+  /* Files written with 'asyncfsync' may still be synced. */
+  write_sync_wait();
+
   if (p_viminfo && *p_viminfo != NUL)
     /* Write out the registers, history, marks etc, to the viminfo file */
     write_viminfo(NULL, FALSE);
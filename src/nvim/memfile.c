@@ -111,6 +111,8 @@ memfile_T *mf_open(char_u *fname, int flags)
   mfp->mf_used_count = 0;
   mf_hash_init(&mfp->mf_hash);
   mf_hash_init(&mfp->mf_trans);
+  mfp->mf_bhdr_slabs = NULL;
+  mfp->mf_bhdr_unused = NULL;
   mfp->mf_page_size = MEMFILE_PAGE_SIZE;
 
   // Try to set the page size equal to device's block size. Speeds up I/O a lot.
@@ -203,14 +205,17 @@ void mf_close(memfile_T *mfp, bool del_file)
   }
   if (del_file && mfp->mf_fname != NULL)
     os_remove((char *)mfp->mf_fname);
-  // free entries in used list
+  // free memory of entries in used list, the headers go with the slabs
   for (hp = mfp->mf_used_first; hp != NULL; hp = nextp) {
     total_mem_used -= hp->bh_page_count * mfp->mf_page_size;
     nextp = hp->bh_next;
-    mf_free_bhdr(hp);
+    xfree(hp->bh_data);
+  }
+  for (mf_bhdr_slab_T *slab = mfp->mf_bhdr_slabs; slab != NULL; ) {
+    mf_bhdr_slab_T *next = slab->mbs_next;
+    xfree(slab);
+    slab = next;
   }
-  while (mfp->mf_free_first != NULL)    // free entries in free list
-    xfree(mf_rem_free(mfp));
   mf_hash_free(&mfp->mf_hash);
   mf_hash_free_all(&mfp->mf_trans);     // free hashtable and its items
   xfree(mfp->mf_fname);
@@ -302,7 +307,7 @@ bhdr_T *mf_new(memfile_T *mfp, bool negative, unsigned page_count)
     } else {                    // use the number, remove entry from free list
       freep = mf_rem_free(mfp);
       hp->bh_bnum = freep->bh_bnum;
-      xfree(freep);
+      mf_put_bhdr(mfp, freep);
     }
   } else {                      // get a new number
     if (hp == NULL) {
@@ -360,17 +365,16 @@ bhdr_T *mf_get(memfile_T *mfp, blocknr_T nr, unsigned page_count)
     hp->bh_flags = 0;
     hp->bh_page_count = page_count;
     if (mf_read(mfp, hp) == FAIL) {             // cannot read the block
-      mf_free_bhdr(hp);
+      mf_free_bhdr(mfp, hp);
       return NULL;
     }
+    mf_ins_hash(mfp, hp);
   } else {
     mf_rem_used(mfp, hp);       // remove from list, insert in front below
-    mf_rem_hash(mfp, hp);
   }
 
   hp->bh_flags |= BH_LOCKED;
   mf_ins_used(mfp, hp);         // put in front of used list
-  mf_ins_hash(mfp, hp);         // put in front of hash list
 
   return hp;
 }
@@ -402,7 +406,7 @@ void mf_free(memfile_T *mfp, bhdr_T *hp)
   mf_rem_hash(mfp, hp);         // get *hp out of the hash list
   mf_rem_used(mfp, hp);         // get *hp out of the used list
   if (hp->bh_bnum < 0) {
-    xfree(hp);                   // don't want negative numbers in free list
+    mf_put_bhdr(mfp, hp);       // don't want negative numbers in free list
     mfp->mf_neg_count--;
   } else {
     mf_ins_free(mfp, hp);       // put *hp in the free list
@@ -512,19 +516,19 @@ void mf_set_dirty(memfile_T *mfp)
   mfp->mf_dirty = true;
 }
 
-/// Insert block in front of memfile's hash list.
+/// Insert block in memfile's hash table.
 static void mf_ins_hash(memfile_T *mfp, bhdr_T *hp)
 {
-  mf_hash_add_item(&mfp->mf_hash, (mf_hashitem_T *)hp);
+  mf_hash_add_item(&mfp->mf_hash, hp->bh_bnum, hp);
 }
 
-/// Remove block from memfile's hash list.
+/// Remove block from memfile's hash table.
 static void mf_rem_hash(memfile_T *mfp, bhdr_T *hp)
 {
-  mf_hash_rem_item(&mfp->mf_hash, (mf_hashitem_T *)hp);
+  mf_hash_rem_item(&mfp->mf_hash, hp->bh_bnum);
 }
 
-/// Lookup block with number "nr" in memfile's hash list.
+/// Lookup block with number "nr" in memfile's hash table.
 static bhdr_T *mf_find_hash(memfile_T *mfp, blocknr_T nr)
 {
   return (bhdr_T *)mf_hash_find(&mfp->mf_hash, nr);
@@ -657,7 +661,7 @@ bool mf_release_all(void)
                   || mf_write(mfp, hp) != FAIL)) {
             mf_rem_used(mfp, hp);
             mf_rem_hash(mfp, hp);
-            mf_free_bhdr(hp);
+            mf_free_bhdr(mfp, hp);
             hp = mfp->mf_used_last;    // restart, list was changed
             retval = true;
           } else {
@@ -670,20 +674,44 @@ bool mf_release_all(void)
   return retval;
 }
 
+/// Take a block header from memfile's slabs, adding a slab when all headers
+/// are in use. The header is not initialized.
+static bhdr_T *mf_get_bhdr(memfile_T *mfp)
+{
+  if (mfp->mf_bhdr_unused == NULL) {
+    mf_bhdr_slab_T *slab = xmalloc(sizeof(mf_bhdr_slab_T));
+    slab->mbs_next = mfp->mf_bhdr_slabs;
+    mfp->mf_bhdr_slabs = slab;
+    for (size_t i = 0; i < MF_BHDR_SLAB_SIZE; i++) {
+      mf_put_bhdr(mfp, &slab->mbs_hdrs[i]);
+    }
+  }
+  bhdr_T *hp = mfp->mf_bhdr_unused;
+  mfp->mf_bhdr_unused = hp->bh_next;
+  return hp;
+}
+
+/// Give a block header back to memfile's slabs.
+static void mf_put_bhdr(memfile_T *mfp, bhdr_T *hp)
+{
+  hp->bh_next = mfp->mf_bhdr_unused;
+  mfp->mf_bhdr_unused = hp;
+}
+
 /// Allocate a block header and a block of memory for it.
 static bhdr_T *mf_alloc_bhdr(memfile_T *mfp, unsigned page_count)
 {
-  bhdr_T *hp = xmalloc(sizeof(bhdr_T));
+  bhdr_T *hp = mf_get_bhdr(mfp);
   hp->bh_data = xmalloc(mfp->mf_page_size * page_count);
   hp->bh_page_count = page_count;
   return hp;
 }
 
 /// Free a block header and its block memory.
-static void mf_free_bhdr(bhdr_T *hp)
+static void mf_free_bhdr(memfile_T *mfp, bhdr_T *hp)
 {
   xfree(hp->bh_data);
-  xfree(hp);
+  mf_put_bhdr(mfp, hp);
 }
 
 /// Insert a block in the free list.
@@ -843,7 +871,7 @@ static int mf_trans_add(memfile_T *mfp, bhdr_T *hp)
       freep->bh_page_count -= page_count;
     } else {
       freep = mf_rem_free(mfp);
-      xfree(freep);
+      mf_put_bhdr(mfp, freep);
     }
   } else {
     new_bnum = mfp->mf_blocknr_max;
@@ -858,7 +886,7 @@ static int mf_trans_add(memfile_T *mfp, bhdr_T *hp)
   mf_ins_hash(mfp, hp);                     // insert in new hash list
 
   // Insert "np" into "mf_trans" hashtable with key "np->nt_old_bnum".
-  mf_hash_add_item(&mfp->mf_trans, (mf_hashitem_T *)np);
+  mf_hash_add_item(&mfp->mf_trans, np->nt_old_bnum, np);
 
   return OK;
 }
@@ -879,7 +907,7 @@ blocknr_T mf_trans_del(memfile_T *mfp, blocknr_T old_nr)
   blocknr_T new_bnum = np->nt_new_bnum;
 
   // remove entry from the trans list
-  mf_hash_rem_item(&mfp->mf_trans, (mf_hashitem_T *)np);
+  mf_hash_rem_item(&mfp->mf_trans, old_nr);
 
   xfree(np);
 
@@ -960,17 +988,17 @@ static void mf_do_open(memfile_T *mfp, char_u *fname, int flags)
 // Implementation of mf_hashtab_T.
 //
 
-/// The number of buckets in the hashtable is increased by a factor of
-/// MHT_GROWTH_FACTOR when the average number of items per bucket
-/// exceeds 2 ^ MHT_LOG_LOAD_FACTOR.
-#define MHT_LOG_LOAD_FACTOR 6
+/// The number of slots in the hashtable is increased by a factor of
+/// MHT_GROWTH_FACTOR when more than 1 / 2 ^ MHT_LOG_LOAD_FACTOR of them
+/// would be in use. Keeping the table sparse keeps probe sequences short.
+#define MHT_LOG_LOAD_FACTOR 1
 #define MHT_GROWTH_FACTOR   2   // must be a power of two
 
 /// Initialize an empty hash table.
 static void mf_hash_init(mf_hashtab_T *mht)
 {
   memset(mht, 0, sizeof(mf_hashtab_T));
-  mht->mht_buckets = mht->mht_small_buckets;
+  mht->mht_slots = mht->mht_small_slots;
   mht->mht_mask = MHT_INIT_SIZE - 1;
 }
 
@@ -978,65 +1006,73 @@ static void mf_hash_init(mf_hashtab_T *mht)
 /// The hash table must not be used again without another mf_hash_init() call.
 static void mf_hash_free(mf_hashtab_T *mht)
 {
-  if (mht->mht_buckets != mht->mht_small_buckets)
-    xfree(mht->mht_buckets);
+  if (mht->mht_slots != mht->mht_small_slots)
+    xfree(mht->mht_slots);
 }
 
 /// Free the array of a hash table and all the items it contains.
 static void mf_hash_free_all(mf_hashtab_T *mht)
 {
-  mf_hashitem_T *next;
-
   for (size_t idx = 0; idx <= mht->mht_mask; idx++)
-    for (mf_hashitem_T *mhi = mht->mht_buckets[idx]; mhi != NULL; mhi = next) {
-      next = mhi->mhi_next;
-      xfree(mhi);
-    }
+    xfree(mht->mht_slots[idx].mhi_item);
 
   mf_hash_free(mht);
 }
 
+/// Find the slot holding "key", or the empty slot ending its probe sequence.
+static mf_hashitem_T *mf_hash_lookup(mf_hashtab_T *mht, blocknr_T key)
+{
+  size_t idx = (size_t)key & mht->mht_mask;
+  while (mht->mht_slots[idx].mhi_item != NULL
+         && mht->mht_slots[idx].mhi_key != key)
+    idx = (idx + 1) & mht->mht_mask;
+  return &mht->mht_slots[idx];
+}
+
 /// Find by key.
 ///
-/// @return  A pointer to a mf_hashitem_T or NULL if the item was not found.
-static mf_hashitem_T *mf_hash_find(mf_hashtab_T *mht, blocknr_T key)
+/// @return  A pointer to the item or NULL if the item was not found.
+static void *mf_hash_find(mf_hashtab_T *mht, blocknr_T key)
 {
-  mf_hashitem_T *mhi = mht->mht_buckets[(size_t)key & mht->mht_mask];
-  while (mhi != NULL && mhi->mhi_key != key)
-    mhi = mhi->mhi_next;
-  return mhi;
+  return mf_hash_lookup(mht, key)->mhi_item;
 }
 
-/// Add item to hashtable. Item must not be NULL.
-static void mf_hash_add_item(mf_hashtab_T *mht, mf_hashitem_T *mhi)
+/// Add item to hashtable. Item must not be NULL and key must not be in
+/// the hashtable yet.
+static void mf_hash_add_item(mf_hashtab_T *mht, blocknr_T key, void *item)
 {
-  size_t idx = (size_t)mhi->mhi_key & mht->mht_mask;
-  mhi->mhi_next = mht->mht_buckets[idx];
-  mhi->mhi_prev = NULL;
-  if (mhi->mhi_next != NULL)
-    mhi->mhi_next->mhi_prev = mhi;
-  mht->mht_buckets[idx] = mhi;
-
-  mht->mht_count++;
-
-  /// Grow hashtable when we have more thank 2^MHT_LOG_LOAD_FACTOR
-  /// items per bucket on average.
-  if ((mht->mht_count >> MHT_LOG_LOAD_FACTOR) > mht->mht_mask) {
+  /// Grow hashtable before more than 1 / 2^MHT_LOG_LOAD_FACTOR of the slots
+  /// are in use.
+  if (((mht->mht_count + 1) << MHT_LOG_LOAD_FACTOR) > mht->mht_mask + 1) {
     mf_hash_grow(mht);
   }
+
+  mf_hashitem_T *mhi = mf_hash_lookup(mht, key);
+  assert(mhi->mhi_item == NULL);
+  mhi->mhi_key = key;
+  mhi->mhi_item = item;
+  mht->mht_count++;
 }
 
-/// Remove item from hashtable. Item must be non NULL and within hashtable.
-static void mf_hash_rem_item(mf_hashtab_T *mht, mf_hashitem_T *mhi)
+/// Remove item with "key" from hashtable. Key must be within hashtable.
+static void mf_hash_rem_item(mf_hashtab_T *mht, blocknr_T key)
 {
-  if (mhi->mhi_prev == NULL)
-    mht->mht_buckets[(size_t)mhi->mhi_key & mht->mht_mask] =
-      mhi->mhi_next;
-  else
-    mhi->mhi_prev->mhi_next = mhi->mhi_next;
-
-  if (mhi->mhi_next != NULL)
-    mhi->mhi_next->mhi_prev = mhi->mhi_prev;
+  size_t mask = mht->mht_mask;
+  mf_hashitem_T *slots = mht->mht_slots;
+  size_t hole = (size_t)(mf_hash_lookup(mht, key) - slots);
+  assert(slots[hole].mhi_item != NULL);
+
+  /// Move later items of the probe sequence into the hole, unless their
+  /// home slot lies cyclically in (hole, idx], where they must stay.
+  for (size_t idx = (hole + 1) & mask; slots[idx].mhi_item != NULL;
+       idx = (idx + 1) & mask) {
+    size_t home = (size_t)slots[idx].mhi_key & mask;
+    if (((idx - home) & mask) >= ((idx - hole) & mask)) {
+      slots[hole] = slots[idx];
+      hole = idx;
+    }
+  }
+  slots[hole].mhi_item = NULL;
 
   mht->mht_count--;
 
@@ -1044,52 +1080,22 @@ static void mf_hash_rem_item(mf_hashtab_T *mht, mf_hashitem_T *mhi)
   // so why bother?
 }
 
-/// Increase number of buckets in the hashtable by MHT_GROWTH_FACTOR and
+/// Increase number of slots in the hashtable by MHT_GROWTH_FACTOR and
 /// rehash items.
 static void mf_hash_grow(mf_hashtab_T *mht)
 {
-  size_t size = (mht->mht_mask + 1) * MHT_GROWTH_FACTOR * sizeof(void *);
-  mf_hashitem_T **buckets = xcalloc(1, size);
-
-  int shift = 0;
-  while ((mht->mht_mask >> shift) != 0)
-    shift++;
-
-  for (size_t i = 0; i <= mht->mht_mask; i++) {
-    /// Traverse the items in the i-th original bucket and move them into
-    /// MHT_GROWTH_FACTOR new buckets, preserving their relative order
-    /// within each new bucket. Preserving the order is important because
-    /// mf_get() tries to keep most recently used items at the front of
-    /// each bucket.
-    ///
-    /// Here we strongly rely on the fact that hashes are computed modulo
-    /// a power of two.
-
-    mf_hashitem_T *tails[MHT_GROWTH_FACTOR];
-    memset(tails, 0, sizeof(tails));
-
-    for (mf_hashitem_T *mhi = mht->mht_buckets[i];
-         mhi != NULL; mhi = mhi->mhi_next) {
-      size_t j = (mhi->mhi_key >> shift) & (MHT_GROWTH_FACTOR - 1);
-      if (tails[j] == NULL) {
-        buckets[i + (j << shift)] = mhi;
-        tails[j] = mhi;
-        mhi->mhi_prev = NULL;
-      } else {
-        tails[j]->mhi_next = mhi;
-        mhi->mhi_prev = tails[j];
-        tails[j] = mhi;
-      }
-    }
+  mf_hashitem_T *old_slots = mht->mht_slots;
+  size_t old_size = mht->mht_mask + 1;
 
-    for (size_t j = 0; j < MHT_GROWTH_FACTOR; j++)
-      if (tails[j] != NULL)
-        tails[j]->mhi_next = NULL;
-  }
+  mht->mht_mask = old_size * MHT_GROWTH_FACTOR - 1;
+  mht->mht_slots = xcalloc(mht->mht_mask + 1, sizeof(mf_hashitem_T));
 
-  if (mht->mht_buckets != mht->mht_small_buckets)
-    xfree(mht->mht_buckets);
+  for (size_t i = 0; i < old_size; i++) {
+    if (old_slots[i].mhi_item != NULL) {
+      *mf_hash_lookup(mht, old_slots[i].mhi_key) = old_slots[i];
+    }
+  }
 
-  mht->mht_buckets = buckets;
-  mht->mht_mask = (mht->mht_mask + 1) * MHT_GROWTH_FACTOR - 1;
+  if (old_slots != mht->mht_small_slots)
+    xfree(old_slots);
 }
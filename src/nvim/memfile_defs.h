@@ -13,36 +13,31 @@
 /// with negative numbers are currently in memory only.
 typedef int64_t blocknr_T;
 
-/// A hash item.
+/// A hash table slot.
 ///
-/// Items' keys are block numbers.
-/// Items in the same bucket are organized into a doubly-linked list.
-///
-/// Therefore, items can be arbitrary data structures beginning with pointers
-/// for the list and and a block number key.
+/// Slots are stored inline in the table, so a lookup usually reads a single
+/// cache line. An empty slot has a NULL item.
 typedef struct mf_hashitem {
-  struct mf_hashitem *mhi_next;
-  struct mf_hashitem *mhi_prev;
-  blocknr_T mhi_key;
+  blocknr_T mhi_key;            /// block number key
+  void *mhi_item;               /// the item, NULL for an empty slot
 } mf_hashitem_T;
 
 /// Initial size for a hashtable.
 #define MHT_INIT_SIZE 64
 
-/// A chained hashtable with block numbers as keys and arbitrary data structures
-/// as items.
+/// An open-addressing hashtable with block numbers as keys and arbitrary data
+/// structures as items.
 ///
-/// This is an intrusive data structure: we require that items begin with
-/// mf_hashitem_T which contains the key and linked list pointers. List of items
-/// in each bucket is doubly-linked.
+/// Collisions are resolved by linear probing. Removing an item shifts the
+/// following slots of its probe sequence back, so no tombstones are needed.
 typedef struct mf_hashtab {
   size_t mht_mask;              /// mask used to mod hash value to array index
-                                /// (nr of items in array is 'mht_mask + 1')
+                                /// (nr of slots in array is 'mht_mask + 1')
   size_t mht_count;             /// number of items inserted
-  mf_hashitem_T **mht_buckets;  /// points to the array of buckets (can be
-                                /// mht_small_buckets or a newly allocated array
-                                /// when mht_small_buckets becomes too small)
-  mf_hashitem_T *mht_small_buckets[MHT_INIT_SIZE];     /// initial buckets
+  mf_hashitem_T *mht_slots;     /// points to the array of slots (can be
+                                /// mht_small_slots or a newly allocated array
+                                /// when mht_small_slots becomes too small)
+  mf_hashitem_T mht_small_slots[MHT_INIT_SIZE];  /// initial slots
 } mf_hashtab_T;
 
 /// A block header.
@@ -50,19 +45,17 @@ typedef struct mf_hashtab {
 /// There is a block header for each previously used block in the memfile.
 ///
 /// The block may be linked in the used list OR in the free list.
-/// The used blocks are also kept in hash lists.
+/// The used blocks are also kept in the hash table.
 ///
 /// The used list is a doubly linked list, most recently used block first.
 /// The blocks in the used list have a block of memory allocated.
 /// mf_used_count is the number of pages in the used list.
-/// The hash lists are used to quickly find a block in the used list.
+/// The hash table is used to quickly find a block in the used list.
 /// The free list is a single linked list, not sorted.
 /// The blocks in the free list have no block of memory allocated and
 /// the contents of the block in the file (if any) is irrelevant.
 typedef struct bhdr {
-  mf_hashitem_T bh_hashitem;         /// header for hash table and key
-#define bh_bnum bh_hashitem.mhi_key  /// block number, part of bh_hashitem
-
+  blocknr_T bh_bnum;                 /// block number, key in mf_hash
   struct bhdr *bh_next;              /// next block header in free or used list
   struct bhdr *bh_prev;              /// previous block header in used list
   void *bh_data;                     /// pointer to memory (for used block)
@@ -73,15 +66,27 @@ typedef struct bhdr {
   unsigned bh_flags;                 // BH_DIRTY or BH_LOCKED
 } bhdr_T;
 
+/// Number of block headers in a slab.
+#define MF_BHDR_SLAB_SIZE 64
+
+/// A slab of block headers.
+///
+/// Block headers are carved out of slabs instead of being allocated one by
+/// one. Unused headers are kept in a list and reused; the slabs themselves
+/// are only freed when the memfile is closed.
+typedef struct mf_bhdr_slab {
+  struct mf_bhdr_slab *mbs_next;         /// next slab of the memfile
+  bhdr_T mbs_hdrs[MF_BHDR_SLAB_SIZE];    /// the block headers
+} mf_bhdr_slab_T;
+
 /// A block number translation list item.
 ///
 /// When a block with a negative number is flushed to the file, it gets
 /// a positive number. Because the reference to the block is still the negative
 /// number, we remember the translation to the new positive number in the
-/// double linked trans lists. The structure is the same as the hash lists.
+/// trans hash table, keyed by the old number.
 typedef struct mf_blocknr_trans_item {
-  mf_hashitem_T nt_hashitem;             /// header for hash table and key
-#define nt_old_bnum nt_hashitem.mhi_key  /// old, negative, number
+  blocknr_T nt_old_bnum;                 /// old, negative, number
   blocknr_T nt_new_bnum;                 /// new, positive, number
 } mf_blocknr_trans_item_T;
 
@@ -95,8 +100,10 @@ typedef struct memfile {
   bhdr_T *mf_used_last;              /// lru block header in used list
   unsigned mf_used_count;            /// number of pages in used list
   unsigned mf_used_count_max;        /// maximum number of pages in memory
-  mf_hashtab_T mf_hash;              /// hash lists
-  mf_hashtab_T mf_trans;             /// trans lists
+  mf_hashtab_T mf_hash;              /// block headers by block number
+  mf_hashtab_T mf_trans;             /// trans items by old block number
+  mf_bhdr_slab_T *mf_bhdr_slabs;     /// slabs block headers are taken from
+  bhdr_T *mf_bhdr_unused;            /// unused headers in the slabs
   blocknr_T mf_blocknr_max;          /// highest positive block number + 1
   blocknr_T mf_blocknr_min;          /// lowest negative block number - 1
   blocknr_T mf_neg_count;            /// number of negative blocks numbers
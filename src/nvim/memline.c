@@ -218,6 +218,10 @@ struct block0 {
 
 #define STACK_INCR      5       /* nr of entries added to ml_stack at a time */
 
+#define ML_COMPACT_PAGES 16     /* compact after this many pages of text were
+                                   deleted, see ml_compact_all() */
+#define ML_COMPACT_MSEC  20     /* msec spent compacting at a time */
+
 /*
  * The line number where the first mark may be is remembered.
  * If it is 0 there are no marks at all.
@@ -267,6 +271,9 @@ int ml_open(buf_T *buf)
   buf->b_ml.ml_locked = NULL;   /* no cached block */
   buf->b_ml.ml_line_lnum = 0;   /* no cached line */
   buf->b_ml.ml_chunksize = NULL;
+  buf->b_ml.ml_freed = 0;
+  buf->b_ml.ml_compact_lnum = 0;
+  ml_block_cache_clear(buf);
 
   if (cmdmod.noswapfile) {
     buf->b_p_swf = false;
@@ -288,6 +295,7 @@ int ml_open(buf_T *buf)
   if (mfp == NULL)
     goto error;
 
+  mfp->mf_page_size = (unsigned)p_pgs;
   buf->b_ml.ml_mfp = mfp;
   buf->b_ml.ml_flags = ML_EMPTY;
   buf->b_ml.ml_line_count = 1;
@@ -571,6 +579,7 @@ void ml_close(buf_T *buf, int del_file)
   xfree(buf->b_ml.ml_stack);
   xfree(buf->b_ml.ml_chunksize);
   buf->b_ml.ml_chunksize = NULL;
+  ml_block_cache_clear(buf);
   buf->b_ml.ml_mfp = NULL;
 
   /* Reset the "recovered" flag, give the ATTENTION prompt the next time
@@ -843,7 +852,10 @@ void ml_recover(void)
   buf->b_ml.ml_stack_top = 0;           /* nothing in the stack */
   buf->b_ml.ml_line_lnum = 0;           /* no cached line */
   buf->b_ml.ml_locked = NULL;           /* no locked block */
+  ml_block_cache_clear(buf);
   buf->b_ml.ml_flags = 0;
+  buf->b_ml.ml_freed = 0;
+  buf->b_ml.ml_compact_lnum = 0;
 
   /*
    * open the memfile from the old swap file
@@ -1020,6 +1032,7 @@ void ml_recover(void)
   buf->b_ml.ml_stack_top = 0;
   buf->b_ml.ml_stack = NULL;
   buf->b_ml.ml_stack_size = 0;          /* no stack yet */
+  ml_block_cache_clear(buf);
 
   if (curbuf->b_ffname == NULL)
     cannot_open = TRUE;
@@ -1663,6 +1676,7 @@ void ml_preserve(buf_T *buf, int message)
 
   /* stack is invalid after mf_sync(.., MFS_ALL) */
   buf->b_ml.ml_stack_top = 0;
+  ml_block_cache_clear(buf);
 
   /*
    * Some of the data blocks may have been changed from negative to
@@ -1692,6 +1706,7 @@ void ml_preserve(buf_T *buf, int message)
     if (mf_sync(mfp, MFS_ALL | MFS_FLUSH) == FAIL)
       status = FAIL;
     buf->b_ml.ml_stack_top = 0;             /* stack is invalid now */
+    ml_block_cache_clear(buf);
   }
 theend:
   got_int |= got_int_save;
@@ -1704,6 +1719,255 @@ theend:
   }
 }
 
+/// Compacts the memlines of the buffers where many lines were deleted, see
+/// ml_compact(). Used when waiting for a character. Works a block at a time
+/// and stops after ML_COMPACT_MSEC msec or when a character is available,
+/// the next call continues where it stopped.
+///
+/// @return true when there is more to do.
+bool ml_compact_all(void)
+{
+  proftime_T tm = profile_setlimit(ML_COMPACT_MSEC);
+
+  FOR_ALL_BUFFERS(buf) {
+    memline_T *ml = &buf->b_ml;
+    if (ml->ml_mfp == NULL) {
+      continue;
+    }
+    if (ml->ml_compact_lnum == 0) {
+      if (ml->ml_freed < ML_COMPACT_PAGES * (long)ml->ml_mfp->mf_page_size) {
+        continue;
+      }
+      // Lines deleted from now on count for the next time.
+      ml->ml_compact_lnum = 1;
+      ml->ml_freed = 0;
+    }
+    while (ml_compact_step(buf)) {
+      if (profile_passed_limit(tm) || os_char_avail()) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/// Merges neighbouring blocks in the memline of "buf" that fit in one block.
+///
+/// Data blocks only split when lines are added, so after many deletes lines
+/// end up spread over mostly empty blocks. Adjacent data blocks whose lines
+/// fit in the first one are merged, and so are adjacent pointer blocks.
+/// When the root then has a single pointer block below it, that level is
+/// removed, making the tree less deep.
+void ml_compact(buf_T *buf)
+{
+  if (buf->b_ml.ml_mfp == NULL) {
+    return;
+  }
+  buf->b_ml.ml_compact_lnum = 1;
+  buf->b_ml.ml_freed = 0;
+  while (ml_compact_step(buf)) {
+  }
+}
+
+/// Does one step of compacting the memline of "buf", for the data block
+/// holding line "ml_compact_lnum": merges it with the next block below the
+/// same pointer block, or when it is the last one there, merges the pointer
+/// block with the next one, and so on upwards. Moves on to the next data
+/// block when nothing was merged.
+///
+/// @return false when the whole tree was done.
+static bool ml_compact_step(buf_T *buf)
+{
+  memline_T *ml = &buf->b_ml;
+  memfile_T *mfp = ml->ml_mfp;
+  linenr_T lnum = ml->ml_compact_lnum;
+
+  if (lnum < 1 || lnum > ml->ml_line_count || (ml->ml_flags & ML_EMPTY)) {
+    ml->ml_compact_lnum = 0;
+    ml_compact_root(buf);
+    return false;
+  }
+
+  // Get a fresh stack of the pointer blocks leading to the data block.
+  ml_flush_line(buf);
+  (void)ml_find_line(buf, (linenr_T)0, ML_FLUSH);
+  ml_block_cache_clear(buf);
+  ml->ml_stack_top = 0;
+  if (ml_find_line(buf, lnum, ML_FIND) == NULL) {
+    ml->ml_compact_lnum = 0;
+    return false;
+  }
+  linenr_T high = ml->ml_locked_high;
+  (void)ml_find_line(buf, (linenr_T)0, ML_FLUSH);
+  int depth = ml->ml_stack_top;
+  ml->ml_stack_top = 0;         // stack is invalid after merging
+  ml_block_cache_clear(buf);
+
+  bool merged = false;
+  for (int level = depth - 1; level >= 0; level--) {
+    int r = ml_compact_merge(mfp, &ml->ml_stack[level]);
+    if (r != NOTDONE) {
+      merged = r == OK;
+      break;
+    }
+  }
+  // After a merge try again, more may fit in the same block.
+  if (!merged) {
+    ml->ml_compact_lnum = high + 1;
+  }
+  return true;
+}
+
+/// Merges the block of the entry "ip->ip_index" of the pointer block
+/// "ip->ip_bnum" with the block of the next entry, if they fit in one block.
+///
+/// @return OK when merged, FAIL when not, NOTDONE when there is no next entry.
+static int ml_compact_merge(memfile_T *mfp, infoptr_T *ip)
+{
+  bhdr_T *hp = mf_get(mfp, ip->ip_bnum, 1);
+  if (hp == NULL) {
+    return FAIL;
+  }
+  PTR_BL *pp = hp->bh_data;
+  int idx = ip->ip_index;
+  if (pp->pb_id != PTR_ID || idx < 0) {
+    mf_put(mfp, hp, false, false);
+    return FAIL;
+  }
+  if (idx + 1 >= (int)pp->pb_count) {
+    mf_put(mfp, hp, false, false);
+    return NOTDONE;
+  }
+
+  bool dirty = false;
+  int ret = FAIL;
+  bhdr_T *hp1 = ml_compact_get(mfp, pp, idx, &dirty);
+  bhdr_T *hp2 = hp1 == NULL ? NULL : ml_compact_get(mfp, pp, idx + 1, &dirty);
+  if (hp2 == NULL) {
+    if (hp1 != NULL) {
+      mf_put(mfp, hp1, false, false);
+    }
+  } else if (ml_merge_blocks(hp1->bh_data, hp2->bh_data)) {
+    // The lines of the second block were moved to the first one.
+    DATA_BL *dp = hp1->bh_data;
+    mf_free(mfp, hp2);
+    mf_put(mfp, hp1, true, dp->db_id == DATA_ID);
+    pp->pb_pointer[idx].pe_line_count +=
+      pp->pb_pointer[idx + 1].pe_line_count;
+    pp->pb_count--;
+    memmove(&pp->pb_pointer[idx + 1], &pp->pb_pointer[idx + 2],
+            (size_t)(pp->pb_count - idx - 1) * sizeof(PTR_EN));
+    dirty = true;
+    ret = OK;
+  } else {
+    mf_put(mfp, hp1, false, false);
+    mf_put(mfp, hp2, false, false);
+  }
+  mf_put(mfp, hp, dirty, false);
+  return ret;
+}
+
+/// Pulls up the entries of a single pointer block below the root, the root
+/// itself must stay block 1.
+static void ml_compact_root(buf_T *buf)
+{
+  memfile_T *mfp = buf->b_ml.ml_mfp;
+
+  ml_flush_line(buf);
+  (void)ml_find_line(buf, (linenr_T)0, ML_FLUSH);
+  buf->b_ml.ml_stack_top = 0;   // stack is invalid after merging
+  ml_block_cache_clear(buf);
+
+  bhdr_T *hp = mf_get(mfp, 1, 1);
+  if (hp == NULL) {
+    return;
+  }
+  PTR_BL *pp = hp->bh_data;
+  if (pp->pb_id != PTR_ID) {
+    EMSG(_("E317: pointer block id wrong"));
+    mf_put(mfp, hp, false, false);
+    return;
+  }
+  bool dirty = false;
+  while (pp->pb_count == 1) {
+    bhdr_T *hp2 = ml_compact_get(mfp, pp, 0, &dirty);
+    if (hp2 == NULL) {
+      break;
+    }
+    PTR_BL *pp2 = hp2->bh_data;
+    if (pp2->pb_id != PTR_ID || pp2->pb_count > pp->pb_count_max) {
+      mf_put(mfp, hp2, false, false);
+      break;
+    }
+    memmove(pp->pb_pointer, pp2->pb_pointer,
+            (size_t)pp2->pb_count * sizeof(PTR_EN));
+    pp->pb_count = pp2->pb_count;
+    mf_free(mfp, hp2);
+    dirty = true;
+  }
+  mf_put(mfp, hp, dirty, false);
+}
+
+/// Gets the block of entry "idx" of pointer block "pp", like ml_find_line()
+/// does. Sets "dirty" when a translated block number was stored in "pp".
+static bhdr_T *ml_compact_get(memfile_T *mfp, PTR_BL *pp, int idx,
+                              bool *dirty)
+{
+  PTR_EN *pe = &pp->pb_pointer[idx];
+  if (pe->pe_bnum < 0) {
+    blocknr_T bnum = mf_trans_del(mfp, pe->pe_bnum);
+    if (bnum != pe->pe_bnum) {
+      pe->pe_bnum = bnum;
+      *dirty = true;
+    }
+  }
+  return mf_get(mfp, pe->pe_bnum, (unsigned)pe->pe_page_count);
+}
+
+/// Moves the contents of block "p2" to the end of block "p1" when both are
+/// data blocks or both are pointer blocks and everything fits in "p1".
+///
+/// @return true when merged, "p2" is then no longer used.
+static bool ml_merge_blocks(void *p1, void *p2)
+{
+  DATA_BL *dp1 = p1;
+  DATA_BL *dp2 = p2;
+
+  if (dp1->db_id == DATA_ID && dp2->db_id == DATA_ID) {
+    unsigned text_size = dp2->db_txt_end - dp2->db_txt_start;
+    unsigned count = (unsigned)dp2->db_line_count;
+    if (text_size + count * INDEX_SIZE > dp1->db_free) {
+      return false;
+    }
+    // The text of the second block goes in front of the text of the first
+    // one, indexes are moved by the difference of the text positions.
+    unsigned txt_start = dp1->db_txt_start - text_size;
+    memmove((char *)dp1 + txt_start, (char *)dp2 + dp2->db_txt_start,
+            text_size);
+    unsigned *index = &dp1->db_index[dp1->db_line_count];
+    for (unsigned i = 0; i < count; i++) {
+      unsigned mark = dp2->db_index[i] & DB_MARKED;
+      index[i] = ((dp2->db_index[i] & DB_INDEX_MASK) + dp1->db_txt_start
+                  - dp2->db_txt_end) | mark;
+    }
+    dp1->db_txt_start = txt_start;
+    dp1->db_free -= text_size + count * INDEX_SIZE;
+    dp1->db_line_count += (linenr_T)count;
+    return true;
+  }
+
+  PTR_BL *pp1 = p1;
+  PTR_BL *pp2 = p2;
+  if (pp1->pb_id == PTR_ID && pp2->pb_id == PTR_ID
+      && pp1->pb_count + pp2->pb_count <= pp1->pb_count_max) {
+    memmove(&pp1->pb_pointer[pp1->pb_count], pp2->pb_pointer,
+            (size_t)pp2->pb_count * sizeof(PTR_EN));
+    pp1->pb_count += pp2->pb_count;
+    return true;
+  }
+  return false;
+}
+
 /*
  * NOTE: The pointer returned by the ml_get_*() functions only remains valid
  * until the next call!
@@ -1805,6 +2069,56 @@ errorret:
   return buf->b_ml.ml_line_ptr;
 }
 
+/// Initializes an iterator over lines "start" to "end" of "buf".
+///
+/// "end" is clipped to the last line of the buffer. Use ml_iter_next() to get
+/// the lines; the buffer must not be changed while iterating.
+void ml_iter_init(MemlineIter *iter, buf_T *buf, linenr_T start, linenr_T end)
+  FUNC_ATTR_NONNULL_ALL
+{
+  iter->mli_buf = buf;
+  iter->mli_lnum = MAX(start, 1);
+  iter->mli_end = MIN(end, buf->b_ml.ml_line_count);
+}
+
+/// Gets the next line of a MemlineIter.
+///
+/// The length of a line is taken from the index of its data block, so unlike
+/// ml_get_buf() + STRLEN() the text doesn't have to be scanned. Consecutive
+/// lines come from the locked block without searching the tree.
+///
+/// @param[out] line  The line, only valid until the next call.
+/// @param[out] len   Length of the line, excluding the NUL.
+/// @return false when there are no more lines.
+bool ml_iter_next(MemlineIter *iter, char_u **line, size_t *len)
+  FUNC_ATTR_NONNULL_ALL
+{
+  if (iter->mli_lnum > iter->mli_end) {
+    return false;
+  }
+
+  buf_T *buf = iter->mli_buf;
+  linenr_T lnum = iter->mli_lnum++;
+  *line = ml_get_buf(buf, lnum, false);
+
+  memline_T *ml = &buf->b_ml;
+  if (ml->ml_line_lnum == lnum && !(ml->ml_flags & ML_LINE_DIRTY)
+      && ml->ml_locked != NULL
+      && ml->ml_locked_low <= lnum && lnum <= ml->ml_locked_high) {
+    DATA_BL *dp = ml->ml_locked->bh_data;
+    int idx = (int)(lnum - ml->ml_locked_low);
+    unsigned start = dp->db_index[idx] & DB_INDEX_MASK;
+    // Text is stored backwards, the previous line ends where this one starts
+    unsigned end = idx == 0
+                   ? dp->db_txt_end
+                   : dp->db_index[idx - 1] & DB_INDEX_MASK;
+    *len = end - start - 1;
+  } else {
+    *len = STRLEN(*line);
+  }
+  return true;
+}
+
 /*
  * Check if a line that was just obtained by a call to ml_get
  * is in allocated memory.
@@ -1818,6 +2132,7 @@ int ml_line_alloced(void)
  * Append a line after lnum (may be 0 to insert a line in front of the file).
  * "line" does not need to be allocated, but can't be another line in a
  * buffer, unlocking may make it invalid.
+ * When "len" is given "line" does not need to be NUL terminated.
  *
  *   newfile: TRUE when starting to edit a new file, meaning that pe_old_lnum
  *		will be set for recovery
@@ -1984,7 +2299,8 @@ ml_append_int (
     /*
      * copy the text into the block
      */
-    memmove((char *)dp + dp->db_index[db_idx + 1], line, (size_t)len);
+    memmove((char *)dp + dp->db_index[db_idx + 1], line, (size_t)len - 1);
+    *((char_u *)dp + dp->db_index[db_idx + 1] + len - 1) = NUL;
     if (mark)
       dp->db_index[db_idx + 1] |= DB_MARKED;
 
@@ -2083,7 +2399,8 @@ ml_append_int (
         dp_right->db_index[0] |= DB_MARKED;
 
       memmove((char *)dp_right + dp_right->db_txt_start,
-          line, (size_t)len);
+          line, (size_t)len - 1);
+      *((char_u *)dp_right + dp_right->db_txt_start + len - 1) = NUL;
       ++line_count_right;
     }
     /*
@@ -2121,7 +2438,8 @@ ml_append_int (
       if (mark)
         dp_left->db_index[line_count_left] |= DB_MARKED;
       memmove((char *)dp_left + dp_left->db_txt_start,
-          line, (size_t)len);
+          line, (size_t)len - 1);
+      *((char_u *)dp_left + dp_left->db_txt_start + len - 1) = NUL;
       ++line_count_left;
     }
 
@@ -2305,6 +2623,7 @@ ml_append_int (
     if (stack_idx < 0) {
       EMSG(_("E318: Updated too many blocks?"));
       buf->b_ml.ml_stack_top = 0;       /* invalidate stack */
+      ml_block_cache_clear(buf);
     }
   }
 
@@ -2313,6 +2632,128 @@ ml_append_int (
   return OK;
 }
 
+/// Appends "count" lines after line "lnum" of the current buffer.
+///
+/// Unlike calling ml_append() "count" times, the lines that fit in a data
+/// block are inserted with a single move of the text that follows them.  When
+/// the block is full a line goes through ml_append_int(), which splits it.
+/// The caller should call appended_lines() (or appended_lines_mark()) once
+/// afterwards.
+///
+/// @return FAIL for failure, OK otherwise
+int ml_append_lines(linenr_T lnum, char_u **lines, long count)
+{
+  buf_T *buf = curbuf;
+
+  if (count <= 0) {
+    return OK;
+  }
+
+  // When starting up, we might still need to create the memfile
+  if (buf->b_ml.ml_mfp == NULL && open_buffer(FALSE, NULL, 0) == FAIL) {
+    return FAIL;
+  }
+
+  if (lnum < 0 || lnum > buf->b_ml.ml_line_count) {
+    return FAIL;
+  }
+
+  ml_flush_line(buf);
+
+  while (count > 0) {
+    bhdr_T *hp = ml_find_line(buf, lnum == 0 ? 1 : lnum, ML_FIND);
+    if (hp == NULL) {
+      return FAIL;
+    }
+
+    // Find how many lines fit in the free space of the block
+    DATA_BL *dp = hp->bh_data;
+    long room = (long)dp->db_free;
+    long max = MIN(count, ml_chunk_room(buf, lnum));
+    int n = 0;
+    int size = 0;
+    while (n < max) {
+      long len = (long)STRLEN(lines[n]) + 1;
+      if (len + (long)INDEX_SIZE > room) {
+        break;
+      }
+      room -= len + (long)INDEX_SIZE;
+      size += (int)len;
+      n++;
+    }
+
+    if (n > 1) {
+      int idx = lnum == 0 ? -1 : (int)(lnum - buf->b_ml.ml_locked_low);
+      insert_block_lines(buf, dp, lnum, idx, lines, n, size);
+    } else {
+      n = 1;
+      if (ml_append_int(buf, lnum, lines[0], 0, FALSE, FALSE) == FAIL) {
+        return FAIL;
+      }
+    }
+    lnum += n;
+    lines += n;
+    count -= n;
+  }
+
+  return OK;
+}
+
+// Inserts "n" lines of "size" bytes, including NULs, after line "idx" (-1
+// for the first line) of the locked data block "dp". "lnum" is the buffer
+// line number of "idx". The block must have room for the lines.
+static void insert_block_lines(buf_T *buf, DATA_BL *dp, linenr_T lnum,
+                               int idx, char_u **lines, int n, int size)
+{
+  int block_count = (int)(buf->b_ml.ml_locked_high
+                          - buf->b_ml.ml_locked_low + 1);
+  // Text is stored backwards, the new lines go just before the text of line
+  // "idx"
+  int offset = idx < 0
+               ? (int)dp->db_txt_end
+               : (int)(dp->db_index[idx] & DB_INDEX_MASK);
+
+  // Move the text of the following lines back to make room
+  memmove((char *)dp + dp->db_txt_start - size,
+          (char *)dp + dp->db_txt_start,
+          (size_t)offset - dp->db_txt_start);
+  for (int i = block_count - 1; i > idx; i--) {
+    dp->db_index[i + n] = dp->db_index[i] - (unsigned)size;
+  }
+
+  for (int i = 0; i < n; i++) {
+    size_t len = STRLEN(lines[i]) + 1;
+    offset -= (int)len;
+    dp->db_index[idx + 1 + i] = (unsigned)offset;
+    memmove((char *)dp + offset, lines[i], len);
+  }
+
+  dp->db_free -= (unsigned)size + (unsigned)n * INDEX_SIZE;
+  dp->db_txt_start -= (unsigned)size;
+  dp->db_line_count += n;
+
+  if (lowest_marked && lowest_marked > lnum) {
+    lowest_marked = lnum + 1;
+  }
+
+  ml_block_cache_clear(buf);
+
+  buf->b_ml.ml_flags &= ~ML_EMPTY;
+  buf->b_ml.ml_line_count += n;
+  buf->b_ml.ml_locked_high += n;
+  // The line counts of the pointer blocks are updated when the block is
+  // released
+  buf->b_ml.ml_locked_lineadd += n;
+  buf->b_ml.ml_flags |= (ML_LOCKED_DIRTY | ML_LOCKED_POS);
+
+  // Byte counts for line2byte() are updated line by line, last because this
+  // may release the locked block
+  for (int i = 0; i < n; i++) {
+    ml_updatechunk(buf, lnum + 1 + i, (long)STRLEN(lines[i]) + 1,
+                   ML_CHNK_ADDLINE);
+  }
+}
+
 /*
  * Replace line lnum, with buffering, in current buffer.
  *
@@ -2493,12 +2934,124 @@ static int ml_delete_int(buf_T *buf, linenr_T lnum, int message)
      * mark the block dirty and make sure it is in the file (for recovery)
      */
     buf->b_ml.ml_flags |= (ML_LOCKED_DIRTY | ML_LOCKED_POS);
+    buf->b_ml.ml_freed += (long)line_size + (long)INDEX_SIZE;
   }
 
   ml_updatechunk(buf, lnum, line_size, ML_CHNK_DELLINE);
   return OK;
 }
 
+/// Deletes "count" lines starting at "lnum" in the current buffer.
+///
+/// Unlike calling ml_delete() "count" times, the lines held by a data block
+/// are removed with a single move of the remaining text, so deleting a large
+/// range costs one pass over each affected block.
+/// The caller must make sure the range is inside the buffer and should call
+/// deleted_lines() (or deleted_lines_mark()) once afterwards.
+///
+/// @return FAIL for failure, OK otherwise
+int ml_delete_lines(linenr_T lnum, long count, int message)
+{
+  buf_T *buf = curbuf;
+
+  if (count <= 0) {
+    return OK;
+  }
+
+  if (lnum < 1 || lnum + count - 1 > buf->b_ml.ml_line_count) {
+    return FAIL;
+  }
+
+  ml_flush_line(buf);
+
+  while (count > 0) {
+    if (buf->b_ml.ml_line_count == 1) {
+      // The buffer becomes empty
+      return ml_delete_int(buf, lnum, message);
+    }
+
+    bhdr_T *hp = ml_find_line(buf, lnum, ML_FIND);
+    if (hp == NULL) {
+      return FAIL;
+    }
+
+    DATA_BL *dp = hp->bh_data;
+    int block_count = (int)(buf->b_ml.ml_locked_high
+                            - buf->b_ml.ml_locked_low + 1);
+    int idx = (int)(lnum - buf->b_ml.ml_locked_low);
+    int n = (int)MIN(count, block_count - idx);
+
+    if (n == block_count) {
+      // The block becomes empty, ml_delete_int() takes care of removing it
+      // from the tree once a single line is left.
+      n--;
+    }
+
+    if (n > 1) {
+      delete_block_lines(buf, dp, lnum, idx, n, block_count);
+      count -= n;
+    } else {
+      if (ml_delete_int(buf, lnum, message) == FAIL) {
+        return FAIL;
+      }
+      count--;
+    }
+  }
+
+  return OK;
+}
+
+// Removes lines "idx" to "idx + n - 1" from the locked data block "dp".
+// "lnum" is the buffer line number of "idx". There must be lines left in
+// the block afterwards.
+static void delete_block_lines(buf_T *buf, DATA_BL *dp, linenr_T lnum,
+                               int idx, int n, int block_count)
+{
+  // Text is stored backwards, the first line is at the end of the block
+  int text_end = idx == 0
+                 ? (int)dp->db_txt_end
+                 : (int)(dp->db_index[idx - 1] & DB_INDEX_MASK);
+  int text_start = (int)(dp->db_index[idx + n - 1] & DB_INDEX_MASK);
+  int size = text_end - text_start;
+
+  // Byte counts for line2byte() have to be updated line by line
+  for (int i = 0; i < n; i++) {
+    int end = i + idx == 0
+              ? (int)dp->db_txt_end
+              : (int)(dp->db_index[idx + i - 1] & DB_INDEX_MASK);
+    ml_updatechunk(buf, lnum, end - (int)(dp->db_index[idx + i]
+                                          & DB_INDEX_MASK),
+                   ML_CHNK_DELLINE);
+  }
+
+  // Move the text of the following lines forward over the deleted text
+  memmove((char *)dp + dp->db_txt_start + size,
+          (char *)dp + dp->db_txt_start,
+          (size_t)text_start - dp->db_txt_start);
+
+  for (int i = idx; i < block_count - n; i++) {
+    dp->db_index[i] = dp->db_index[i + n] + (unsigned)size;
+  }
+
+  dp->db_free += (unsigned)size + (unsigned)n * INDEX_SIZE;
+  dp->db_txt_start += (unsigned)size;
+  dp->db_line_count -= n;
+
+  if (lowest_marked && lowest_marked > lnum) {
+    lowest_marked = MAX(lnum, lowest_marked - n);
+  }
+
+  ml_block_cache_clear(buf);
+
+  buf->b_ml.ml_line_count -= n;
+  buf->b_ml.ml_locked_high -= n;
+  // The line counts of the pointer blocks are updated when the block is
+  // released
+  buf->b_ml.ml_locked_lineadd -= n;
+  buf->b_ml.ml_flags |= (ML_LOCKED_DIRTY | ML_LOCKED_POS);
+  buf->b_ml.ml_freed += (long)size + n * (long)INDEX_SIZE;
+}
+
 /*
  * set the B_MARKED flag for line 'lnum'
  */
@@ -2764,6 +3317,11 @@ static bhdr_T *ml_find_line(buf_T *buf, linenr_T lnum, int action)
 
   mfp = buf->b_ml.ml_mfp;
 
+  // Line numbers of cached blocks change when inserting or deleting
+  if (action == ML_INSERT || action == ML_DELETE) {
+    ml_block_cache_clear(buf);
+  }
+
   /*
    * If there is a locked block check if the wanted line is in it.
    * If not, flush and release the locked block.
@@ -2802,6 +3360,11 @@ static bhdr_T *ml_find_line(buf_T *buf, linenr_T lnum, int action)
   if (action == ML_FLUSH)           /* nothing else to do */
     return NULL;
 
+  if (action == ML_FIND && !mf_dont_release
+      && (hp = ml_block_cache_find(buf, lnum)) != NULL) {
+    return hp;
+  }
+
   bnum = 1;                         /* start at the root of the tree */
   page_count = 1;
   low = 1;
@@ -2845,6 +3408,9 @@ static bhdr_T *ml_find_line(buf_T *buf, linenr_T lnum, int action)
       buf->b_ml.ml_locked_high = high;
       buf->b_ml.ml_locked_lineadd = 0;
       buf->b_ml.ml_flags &= ~(ML_LOCKED_DIRTY | ML_LOCKED_POS);
+      if (action == ML_FIND) {
+        ml_block_cache_add(buf, bnum, page_count);
+      }
       return hp;
     }
 
@@ -2919,6 +3485,91 @@ error_noblock:
   else if (action == ML_INSERT)
     ml_lineadd(buf, -1);
   buf->b_ml.ml_stack_top = 0;
+  ml_block_cache_clear(buf);
+  return NULL;
+}
+
+/// Forgets all blocks in the block cache of "buf".
+static void ml_block_cache_clear(buf_T *buf)
+{
+  for (int i = 0; i < MLCACHE_SIZE; i++) {
+    buf->b_ml.ml_block_cache[i].mlbc_bnum = 0;
+  }
+  buf->b_ml.ml_block_cache_next = 0;
+}
+
+/// Remembers the data block just locked by ml_find_line(), with the current
+/// stack leading to it.
+static void ml_block_cache_add(buf_T *buf, blocknr_T bnum, int page_count)
+{
+  // A negative block number changes when the block is written
+  if (bnum <= 0 || buf->b_ml.ml_stack_top > MLCACHE_DEPTH) {
+    return;
+  }
+  for (int i = 0; i < buf->b_ml.ml_stack_top; i++) {
+    if (buf->b_ml.ml_stack[i].ip_bnum < 0) {
+      return;
+    }
+  }
+
+  mlblock_cache_T *bc = NULL;
+  for (int i = 0; i < MLCACHE_SIZE; i++) {
+    if (buf->b_ml.ml_block_cache[i].mlbc_bnum == bnum) {
+      bc = &buf->b_ml.ml_block_cache[i];
+      break;
+    }
+  }
+  if (bc == NULL) {
+    bc = &buf->b_ml.ml_block_cache[buf->b_ml.ml_block_cache_next];
+    buf->b_ml.ml_block_cache_next =
+      (buf->b_ml.ml_block_cache_next + 1) % MLCACHE_SIZE;
+  }
+
+  bc->mlbc_bnum = bnum;
+  bc->mlbc_page_count = page_count;
+  bc->mlbc_low = buf->b_ml.ml_locked_low;
+  bc->mlbc_high = buf->b_ml.ml_locked_high;
+  bc->mlbc_depth = buf->b_ml.ml_stack_top;
+  memcpy(bc->mlbc_stack, buf->b_ml.ml_stack,
+         (size_t)bc->mlbc_depth * sizeof(infoptr_T));
+}
+
+/// Locks the cached data block containing "lnum", if there is one, and
+/// restores the stack leading to it.  There must be no locked block.
+///
+/// @return the block or NULL if it is not in the cache.
+static bhdr_T *ml_block_cache_find(buf_T *buf, linenr_T lnum)
+{
+  for (int i = 0; i < MLCACHE_SIZE; i++) {
+    mlblock_cache_T *bc = &buf->b_ml.ml_block_cache[i];
+    if (bc->mlbc_bnum == 0 || lnum < bc->mlbc_low || lnum > bc->mlbc_high) {
+      continue;
+    }
+
+    bhdr_T *hp = mf_get(buf->b_ml.ml_mfp, bc->mlbc_bnum, bc->mlbc_page_count);
+    if (hp == NULL) {
+      bc->mlbc_bnum = 0;
+      return NULL;
+    }
+    if (((DATA_BL *)hp->bh_data)->db_id != DATA_ID) {
+      mf_put(buf->b_ml.ml_mfp, hp, false, false);
+      bc->mlbc_bnum = 0;
+      return NULL;
+    }
+
+    // The stack has been at least this big when the entry was added
+    assert(bc->mlbc_depth <= buf->b_ml.ml_stack_size);
+    memcpy(buf->b_ml.ml_stack, bc->mlbc_stack,
+           (size_t)bc->mlbc_depth * sizeof(infoptr_T));
+    buf->b_ml.ml_stack_top = bc->mlbc_depth;
+
+    buf->b_ml.ml_locked = hp;
+    buf->b_ml.ml_locked_low = bc->mlbc_low;
+    buf->b_ml.ml_locked_high = bc->mlbc_high;
+    buf->b_ml.ml_locked_lineadd = 0;
+    buf->b_ml.ml_flags &= ~(ML_LOCKED_DIRTY | ML_LOCKED_POS);
+    return hp;
+  }
   return NULL;
 }
 
@@ -3625,6 +4276,24 @@ void ml_setflags(buf_T *buf)
 #define MLCS_MAXL 800   /* max no of lines in chunk */
 #define MLCS_MINL 400   /* should be half of MLCS_MAXL */
 
+/// Returns how many lines can be added after line "lnum" before the chunk
+/// they are added to needs to be split.  insert_block_lines() updates the
+/// chunks after adding all lines, splitting would count the lines twice.
+static long ml_chunk_room(buf_T *buf, linenr_T lnum)
+{
+  if (buf->b_ml.ml_usedchunks == -1 || buf->b_ml.ml_chunksize == NULL) {
+    return MLCS_MAXL - 2;
+  }
+  chunksize_T *chunk = buf->b_ml.ml_chunksize;
+  linenr_T curline = 1;
+  while (chunk < buf->b_ml.ml_chunksize + buf->b_ml.ml_usedchunks - 1
+         && lnum + 1 >= curline + chunk->mlcs_numlines) {
+    curline += chunk->mlcs_numlines;
+    chunk++;
+  }
+  return MLCS_MAXL - 1 - chunk->mlcs_numlines;
+}
+
 /*
  * Keep information for finding byte offset of a line, updtype may be one of:
  * ML_CHNK_ADDLINE: Add len to parent chunk, possibly splitting it
@@ -15,6 +15,33 @@ typedef struct info_pointer {
   int ip_index;                 /* index for block with current lnum */
 } infoptr_T;    /* block/index pair */
 
+/*
+ * A data block found by an earlier search, together with the pointer blocks
+ * leading to it, so that going back to it doesn't need to walk down the tree
+ * again.  Only used for ML_FIND, all entries are invalidated when lines are
+ * inserted or deleted.
+ */
+#define MLCACHE_SIZE    4       /* number of blocks remembered */
+#define MLCACHE_DEPTH   8       /* max depth of the tree for a cached block */
+
+typedef struct ml_block_cache {
+  blocknr_T mlbc_bnum;          /* data block number, 0 if entry not used */
+  int mlbc_page_count;          /* number of pages in the block */
+  linenr_T mlbc_low;            /* first line in the block */
+  linenr_T mlbc_high;           /* last line in the block */
+  int mlbc_depth;               /* number of entries in mlbc_stack */
+  infoptr_T mlbc_stack[MLCACHE_DEPTH];  /* ml_stack for the block */
+} mlblock_cache_T;
+
+/*
+ * Iterator over a range of lines, see ml_iter_init().
+ */
+typedef struct {
+  struct file_buffer *mli_buf;
+  linenr_T mli_lnum;            /* next line to return */
+  linenr_T mli_end;             /* last line to return */
+} MemlineIter;
+
 typedef struct ml_chunksize {
   int mlcs_numlines;
   long mlcs_totalsize;
@@ -51,6 +78,15 @@ typedef struct memline {
   linenr_T ml_locked_low;       /* first line in ml_locked */
   linenr_T ml_locked_high;      /* last line in ml_locked */
   int ml_locked_lineadd;            /* number of lines inserted in ml_locked */
+
+  long ml_freed;                /* bytes freed in data blocks by deleting
+                                   lines, see ml_compact_all() */
+  linenr_T ml_compact_lnum;     /* where ml_compact_all() continues, zero
+                                   when not compacting */
+
+  mlblock_cache_T ml_block_cache[MLCACHE_SIZE];  /* recently used blocks */
+  int ml_block_cache_next;      /* entry of ml_block_cache to replace next */
+
   chunksize_T *ml_chunksize;
   int ml_numchunks;
   int ml_usedchunks;
@@ -425,6 +425,100 @@ void *xmemdup(const void *data, size_t len)
   return memcpy(xmalloc(len), data, len);
 }
 
+#define ARENA_BLOCK_SIZE 4096
+#define ARENA_ALIGN MAX(sizeof(void *), sizeof(double))
+
+// Header of every block owned by an arena
+struct consumed_blk {
+  struct consumed_blk *prev;
+};
+
+// A single released block is kept around, so a steady stream of small arenas
+// (one per RPC request) doesn't hit malloc at all.
+static struct consumed_blk *arena_reuse_blk = NULL;
+
+/// Allocates memory from an arena.
+///
+/// @param arena The arena, initialized with `ARENA_EMPTY`
+/// @param size Number of bytes
+/// @param align Align the result for storage of any type
+/// @return pointer to allocated space, valid until arena_mem_free(). Never NULL
+void *arena_alloc(Arena *arena, size_t size, bool align)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_NONNULL_RET FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  if (align) {
+    arena->pos = (arena->pos + (ARENA_ALIGN - 1)) & ~(ARENA_ALIGN - 1);
+  }
+
+  if (arena->cur_blk && arena->pos + size <= arena->size) {
+    char *mem = arena->cur_blk + arena->pos;
+    arena->pos += size;
+    return mem;
+  }
+
+  size_t hdr_size = ARENA_ALIGN;
+  if (size > (ARENA_BLOCK_SIZE - hdr_size) / 2) {
+    // Big allocation: give it a dedicated block and link it behind the
+    // current one, which may still have room for small allocations.
+    struct consumed_blk *blk = xmalloc(hdr_size + size);
+    if (arena->cur_blk) {
+      struct consumed_blk *cur = (struct consumed_blk *)arena->cur_blk;
+      blk->prev = cur->prev;
+      cur->prev = blk;
+    } else {
+      blk->prev = NULL;
+      arena->cur_blk = (char *)blk;
+      arena->pos = arena->size = hdr_size + size;
+    }
+    return (char *)blk + hdr_size;
+  }
+
+  struct consumed_blk *blk;
+  if (arena_reuse_blk) {
+    blk = arena_reuse_blk;
+    arena_reuse_blk = NULL;
+  } else {
+    blk = xmalloc(ARENA_BLOCK_SIZE);
+  }
+  blk->prev = (struct consumed_blk *)arena->cur_blk;
+  arena->cur_blk = (char *)blk;
+  arena->size = ARENA_BLOCK_SIZE;
+  arena->pos = hdr_size + size;
+  return (char *)blk + hdr_size;
+}
+
+/// Allocates (len + 1) bytes from an arena, copies `len` bytes of `data` and
+/// zero terminates the result.
+///
+/// @see {xmemdupz}
+void *arena_memdupz(Arena *arena, const void *data, size_t len)
+  FUNC_ATTR_NONNULL_ALL FUNC_ATTR_NONNULL_RET FUNC_ATTR_WARN_UNUSED_RESULT
+{
+  char *mem = arena_alloc(arena, len + 1, false);
+  memcpy(mem, data, len);
+  mem[len] = '\0';
+  return mem;
+}
+
+/// Releases all memory allocated from an arena and resets it to
+/// `ARENA_EMPTY`.
+void arena_mem_free(Arena *arena)
+  FUNC_ATTR_NONNULL_ALL
+{
+  struct consumed_blk *blk = (struct consumed_blk *)arena->cur_blk;
+  while (blk) {
+    struct consumed_blk *prev = blk->prev;
+    if (!arena_reuse_blk && arena->size == ARENA_BLOCK_SIZE
+        && (char *)blk == arena->cur_blk) {
+      arena_reuse_blk = blk;
+    } else {
+      xfree(blk);
+    }
+    blk = prev;
+  }
+  *arena = (Arena)ARENA_EMPTY;
+}
+
 /*
  * Avoid repeating the error message many times (they take 1 second each).
  * Did_outofmem_msg is reset when a character is read.
@@ -604,6 +698,9 @@ void free_all_mem(void)
   free_screenlines();
 
   clear_hl_tables();
+
+  xfree(arena_reuse_blk);
+  arena_reuse_blk = NULL;
 }
 
 #endif
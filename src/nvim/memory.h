@@ -3,6 +3,18 @@
 
 #include <stdint.h>  // for uint8_t
 #include <stddef.h>  // for size_t
+#include <stdbool.h>
+
+/// Bump allocator. Memory is carved from fixed size blocks and released all
+/// at once with arena_mem_free(), which makes it suitable for short lived
+/// object trees that are built and destroyed as a whole.
+typedef struct {
+  char *cur_blk;  ///< Current block, starts with a pointer to the previous one
+  size_t pos;     ///< Offset of the first free byte in `cur_blk`
+  size_t size;    ///< Size of `cur_blk`
+} Arena;
+
+#define ARENA_EMPTY { .cur_blk = NULL, .pos = 0, .size = 0 }
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "memory.h.generated.h"
@@ -62,6 +62,7 @@
 #include "nvim/os/input.h"
 #include "nvim/os/time.h"
 #include "nvim/event/stream.h"
+#include "nvim/buffer_updates.h"
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "misc1.c.generated.h"
@@ -1772,16 +1773,12 @@ del_lines (
   if (undo && u_savedel(first, nlines) == FAIL)
     return;
 
-  for (n = 0; n < nlines; ) {
-    if (curbuf->b_ml.ml_flags & ML_EMPTY)           /* nothing to delete */
-      break;
-
-    ml_delete(first, TRUE);
-    ++n;
-
-    /* If we delete the last line in the file, stop */
-    if (first > curbuf->b_ml.ml_line_count)
-      break;
+  // Delete up to the last line in the file, if the buffer is not empty
+  // already
+  n = 0;
+  if (!(curbuf->b_ml.ml_flags & ML_EMPTY)) {
+    n = MIN(nlines, curbuf->b_ml.ml_line_count - first + 1);
+    ml_delete_lines(first, n, TRUE);
   }
 
   /* Correct the cursor position before calling deleted_lines_mark(), it may
@@ -1879,6 +1876,7 @@ void changed_bytes(linenr_T lnum, colnr_T col)
 {
   changedOneline(curbuf, lnum);
   changed_common(lnum, col, lnum + 1, 0L);
+  buf_updates_send_changes(curbuf, lnum, 1, 1);
 
   /* Diff highlighting in other diff windows may need to be updated too. */
   if (curwin->w_p_diff) {
@@ -1993,6 +1991,7 @@ changed_lines (
   }
 
   changed_common(lnum, col, lnume, xtra);
+  buf_updates_send_changes(curbuf, lnum, lnume - lnum + xtra, lnume - lnum);
 }
 
 static void 
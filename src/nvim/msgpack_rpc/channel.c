@@ -1,4 +1,5 @@
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
 
@@ -26,6 +27,12 @@
 #include "nvim/lib/kvec.h"
 
 #define CHANNEL_BUFFER_SIZE 0xffff
+// Serialized messages of at least this size are handed to the write stream
+// without copying
+#define SBUFFER_HANDOFF_MIN 0x10000
+// Writes are coalesced until this many bytes are queued. A screen redraw
+// easily produces more than the wstream default of 64KiB in one burst.
+#define CHANNEL_WRITE_HWM 0x40000
 
 #if MIN_LOG_LEVEL > DEBUG_LOG_LEVEL
 #define log_client_msg(...)
@@ -44,6 +51,11 @@ typedef struct {
   Object result;
 } ChannelCallFrame;
 
+typedef struct {
+  channel_response_cb cb;
+  void *data;
+} ChannelAsyncCall;
+
 typedef struct {
   uint64_t id;
   size_t refcount;
@@ -67,6 +79,7 @@ typedef struct {
   } data;
   uint64_t next_request_id;
   kvec_t(ChannelCallFrame *) call_stack;
+  PMap(uint64_t) *async_calls;
   kvec_t(WBuffer *) delayed_notifications;
   Queue *events;
 } Channel;
@@ -76,6 +89,7 @@ typedef struct {
   MsgpackRpcRequestHandler handler;
   Array args;
   uint64_t request_id;
+  Arena arena;
 } RequestEvent;
 
 static uint64_t next_id = 1;
@@ -134,6 +148,7 @@ uint64_t channel_from_process(char **argv)
 
   incref(channel);  // process channels are only closed by the exit_cb
   wstream_init(proc->in, 0);
+  wstream_set_hwm(proc->in, CHANNEL_WRITE_HWM);
   rstream_init(proc->out, 0);
   rstream_start(proc->out, parse_msgpack);
   rstream_init(proc->err, 0);
@@ -153,6 +168,7 @@ void channel_from_connection(SocketWatcher *watcher)
   channel->data.stream.internal_close_cb = close_cb;
   channel->data.stream.internal_data = channel;
   wstream_init(&channel->data.stream, 0);
+  wstream_set_hwm(&channel->data.stream, CHANNEL_WRITE_HWM);
   rstream_init(&channel->data.stream, CHANNEL_BUFFER_SIZE);
   rstream_start(&channel->data.stream, parse_msgpack);
 }
@@ -225,25 +241,7 @@ Object channel_send_call(uint64_t id,
   channel->pending_requests--;
 
   if (frame.errored) {
-    if (frame.result.type == kObjectTypeString) {
-      api_set_error(err, Exception, "%s", frame.result.data.string.data);
-    } else if (frame.result.type == kObjectTypeArray) {
-      // Should be an error in the form [type, message]
-      Array array = frame.result.data.array;
-      if (array.size == 2 && array.items[0].type == kObjectTypeInteger
-          && (array.items[0].data.integer == kErrorTypeException
-              || array.items[0].data.integer == kErrorTypeValidation)
-          && array.items[1].type == kObjectTypeString) {
-        err->type = (ErrorType) array.items[0].data.integer;
-        xstrlcpy(err->msg, array.items[1].data.string.data, sizeof(err->msg));
-        err->set = true;
-      } else {
-        api_set_error(err, Exception, "%s", "unknown error");
-      }
-    } else {
-      api_set_error(err, Exception, "%s", "unknown error");
-    }
-
+    set_error_from_response(frame.result, err);
     api_free_object(frame.result);
   }
 
@@ -256,6 +254,57 @@ Object channel_send_call(uint64_t id,
   return frame.errored ? NIL : frame.result;
 }
 
+/// Sends a method call to a channel without waiting for the response
+///
+/// Any number of asynchronous calls may be in flight on the same channel.
+/// Unlike `channel_send_call`, notifications are not delayed while they are
+/// pending.
+///
+/// @param id The channel id
+/// @param method_name The method name, an arbitrary string
+/// @param args Array with method arguments
+/// @param cb Function called with the response. It is also called with an
+///        error if the channel is closed before the response arrives.
+/// @param data User-defined data passed to `cb`
+/// @param[out] err Set if the request couldn't be sent
+/// @return The request id (> 0), or 0 on error
+uint64_t channel_send_async_call(uint64_t id,
+                                 char *method_name,
+                                 Array args,
+                                 channel_response_cb cb,
+                                 void *data,
+                                 Error *err)
+  FUNC_ATTR_NONNULL_ARG(2, 4, 6)
+{
+  Channel *channel = NULL;
+
+  if (!(channel = pmap_get(uint64_t)(channels, id)) || channel->closed) {
+    api_set_error(err, Exception, _("Invalid channel \"%" PRIu64 "\""), id);
+    api_free_array(args);
+    return 0;
+  }
+
+  uint64_t request_id = channel->next_request_id++;
+  ChannelAsyncCall *call = xmalloc(sizeof(ChannelAsyncCall));
+  call->cb = cb;
+  call->data = data;
+  pmap_put(uint64_t)(channel->async_calls, request_id, call);
+  send_request(channel, request_id, method_name, args);
+  // A failed write closes the channel, which already completed the call
+  return request_id;
+}
+
+/// Gets the queue of events generated by a channel, which must be processed
+/// for requests made by the channel to be handled.
+///
+/// @param id The channel id
+/// @return The event queue, or NULL if the channel doesn't exist
+Queue *channel_get_events(uint64_t id)
+{
+  Channel *channel = pmap_get(uint64_t)(channels, id);
+  return channel ? channel->events : NULL;
+}
+
 /// Subscribes to event broadcasts
 ///
 /// @param id The channel id
@@ -321,6 +370,7 @@ void channel_from_stdio(void)
   rstream_start(&channel->data.std.in, parse_msgpack);
   // write stream
   wstream_init_fd(&loop, &channel->data.std.out, 1, 0, NULL);
+  wstream_set_hwm(&channel->data.std.out, CHANNEL_WRITE_HWM);
 }
 
 static void forward_stderr(Stream *stream, RBuffer *rbuf, size_t count,
@@ -351,45 +401,49 @@ static void parse_msgpack(Stream *stream, RBuffer *rbuf, size_t c, void *data,
     goto end;
   }
 
-  size_t count = rbuffer_size(rbuf);
   DLOG("Feeding the msgpack parser with %u bytes of data from Stream(%p)",
-       count,
+       rbuffer_size(rbuf),
        stream);
 
-  // Feed the unpacker with data
-  msgpack_unpacker_reserve_buffer(channel->unpacker, count);
-  rbuffer_read(rbuf, msgpack_unpacker_buffer(channel->unpacker), count);
-  msgpack_unpacker_buffer_consumed(channel->unpacker, count);
-
   msgpack_unpacked unpacked;
   msgpack_unpacked_init(&unpacked);
   msgpack_unpack_return result;
 
+  // Fast path: As long as the unpacker doesn't hold the head of a partial
+  // message, complete messages are decoded directly from the RBuffer memory.
+  // Strings in the resulting `msgpack_object` tree point into the RBuffer, so
+  // the bytes are only consumed after the message was converted into API
+  // objects by `handle_message`.
+  while (channel->unpacker->off == channel->unpacker->used
+         && rbuffer_size(rbuf)) {
+    size_t size, off = 0;
+    char *ptr = rbuffer_read_ptr(rbuf, &size);
+    result = msgpack_unpack_next(&unpacked, ptr, size, &off);
+    if (result != MSGPACK_UNPACK_SUCCESS) {
+      // Incomplete message (possibly split by the ring buffer wrap) or
+      // invalid payload, let the unpacker handle the remaining data.
+      break;
+    }
+    bool bail = handle_message(channel, &unpacked.data);
+    rbuffer_consumed(rbuf, off);
+    if (bail) {
+      // Move whatever is left to the unpacker so it is picked up on the
+      // next call. It can't stay in the RBuffer because a full RBuffer
+      // stops the stream.
+      feed_unpacker(channel, rbuf);
+      goto done;
+    }
+  }
+
+  // Slow path: Feed the unpacker with the remaining data.
+  feed_unpacker(channel, rbuf);
+
   // Deserialize everything we can.
   while ((result = msgpack_unpacker_next(channel->unpacker, &unpacked)) ==
       MSGPACK_UNPACK_SUCCESS) {
-    bool is_response = is_rpc_response(&unpacked.data);
-    log_client_msg(channel->id, !is_response, unpacked.data);
-
-    if (is_response) {
-      if (is_valid_rpc_response(&unpacked.data, channel)) {
-        complete_call(&unpacked.data, channel);
-      } else {
-        char buf[256];
-        snprintf(buf,
-                 sizeof(buf),
-                 "Channel %" PRIu64 " returned a response that doesn't have "
-                 "a matching request id. Ensure the client is properly "
-                 "synchronized",
-                 channel->id);
-        call_set_error(channel, buf);
-      }
-      msgpack_unpacked_destroy(&unpacked);
-      // Bail out from this event loop iteration
-      goto end;
+    if (handle_message(channel, &unpacked.data)) {
+      goto done;
     }
-
-    handle_request(channel, &unpacked.data);
   }
 
   if (result == MSGPACK_UNPACK_NOMEM_ERROR) {
@@ -411,10 +465,61 @@ static void parse_msgpack(Stream *stream, RBuffer *rbuf, size_t c, void *data,
                            "an object with high level of nesting");
   }
 
+done:
+  msgpack_unpacked_destroy(&unpacked);
 end:
   decref(channel);
 }
 
+/// Copies all data in `rbuf` to the channel unpacker buffer.
+static void feed_unpacker(Channel *channel, RBuffer *rbuf)
+{
+  size_t count = rbuffer_size(rbuf);
+  if (!count) {
+    return;
+  }
+
+  msgpack_unpacker_reserve_buffer(channel->unpacker, count);
+  rbuffer_read(rbuf, msgpack_unpacker_buffer(channel->unpacker), count);
+  msgpack_unpacker_buffer_consumed(channel->unpacker, count);
+}
+
+/// Dispatches a single message received from the channel.
+///
+/// @return true if the caller must stop processing messages in the current
+///         event loop iteration(a response to a pending call was received).
+static bool handle_message(Channel *channel, msgpack_object *msg)
+{
+  bool is_response = is_rpc_response(msg);
+  log_client_msg(channel->id, !is_response, *msg);
+
+  if (!is_response) {
+    handle_request(channel, msg);
+    return false;
+  }
+
+  uint64_t response_id = msg->via.array.ptr[1].via.u64;
+  if (pmap_has(uint64_t)(channel->async_calls, response_id)) {
+    complete_async_call(msg, channel);
+    // Nobody is blocked on this response, keep processing messages
+    return false;
+  } else if (is_valid_rpc_response(msg, channel)) {
+    complete_call(msg, channel);
+  } else {
+    char buf[256];
+    snprintf(buf,
+             sizeof(buf),
+             "Channel %" PRIu64 " returned a response that doesn't have "
+             "a matching request id. Ensure the client is properly "
+             "synchronized",
+             channel->id);
+    call_set_error(channel, buf);
+  }
+
+  // Bail out from this event loop iteration
+  return true;
+}
+
 static void handle_request(Channel *channel, msgpack_object *request)
   FUNC_ATTR_NONNULL_ALL
 {
@@ -449,19 +554,25 @@ static void handle_request(Channel *channel, msgpack_object *request)
   } else {
     handler.fn = msgpack_rpc_handle_missing_method;
     handler.async = true;
+    handler.arena_return = false;
   }
 
+  // The arguments and the event itself are allocated from an arena that is
+  // released in one go after the request was handled.
+  Arena arena = ARENA_EMPTY;
   Array args = ARRAY_DICT_INIT;
-  if (!msgpack_rpc_to_array(msgpack_rpc_args(request), &args)) {
+  if (!msgpack_rpc_to_array_arena(msgpack_rpc_args(request), &args, &arena)) {
     handler.fn = msgpack_rpc_handle_invalid_arguments;
     handler.async = true;
+    handler.arena_return = false;
   }
 
-  RequestEvent *event_data = xmalloc(sizeof(RequestEvent));
+  RequestEvent *event_data = arena_alloc(&arena, sizeof(RequestEvent), true);
   event_data->channel = channel;
   event_data->handler = handler;
   event_data->args = args;
   event_data->request_id = request_id;
+  event_data->arena = arena;
   incref(channel);
   if (handler.async) {
     on_request_event((void **)&event_data);
@@ -478,23 +589,24 @@ static void on_request_event(void **argv)
   Array args = e->args;
   uint64_t request_id = e->request_id;
   Error error = ERROR_INIT;
-  Object result = handler.fn(channel->id, request_id, args, &error);
+  // Copy the arena out of the event, which is allocated from it
+  Arena arena = e->arena;
+  Object result = handler.fn(channel->id, request_id, args, &arena, &error);
   if (request_id != NO_RESPONSE) {
     // send the response
-    msgpack_packer response;
-    msgpack_packer_init(&response, &out_buffer, msgpack_sbuffer_write);
     channel_write(channel, serialize_response(channel->id,
                                               request_id,
                                               &error,
                                               result,
                                               &out_buffer));
-  } else {
+  }
+  if (!handler.arena_return) {
     api_free_object(result);
   }
-  // All arguments were freed already, but we still need to free the array
-  xfree(args.items);
   decref(channel);
-  xfree(e);
+  // Handlers don't take ownership of the arguments, release them along with
+  // the event and arena allocated results
+  arena_mem_free(&arena);
 }
 
 static bool channel_write(Channel *channel, WBuffer *buffer)
@@ -572,6 +684,9 @@ static void send_event(Channel *channel,
                                            1));
 }
 
+/// Sends an event to every channel subscribed to it. The message is serialized
+/// once and the resulting WBuffer is shared by all subscribers, each of them
+/// holding one reference.
 static void broadcast_event(char *name, Array args)
 {
   kvec_t(Channel *) subscribed;
@@ -579,7 +694,8 @@ static void broadcast_event(char *name, Array args)
   Channel *channel;
 
   map_foreach_value(channels, channel, {
-    if (pmap_has(cstr_t)(channel->subscribed_events, name)) {
+    if (!channel->closed
+        && pmap_has(cstr_t)(channel->subscribed_events, name)) {
       kv_push(Channel *, subscribed, channel);
     }
   });
@@ -634,6 +750,7 @@ static void close_channel(Channel *channel)
   }
 
   channel->closed = true;
+  fail_async_calls(channel, "Channel was closed");
 
   switch (channel->type) {
     case kChannelTypeSocket:
@@ -679,6 +796,13 @@ static void free_channel(Channel *channel)
 
   pmap_free(cstr_t)(channel->subscribed_events);
   kv_destroy(channel->call_stack);
+  fail_async_calls(channel, "Channel was closed");
+  pmap_free(uint64_t)(channel->async_calls);
+  // Delayed notifications may be shared with other channels, only drop this
+  // channel's reference
+  for (size_t i = 0; i < kv_size(channel->delayed_notifications); i++) {
+    wstream_release_wbuffer(kv_A(channel->delayed_notifications, i));
+  }
   kv_destroy(channel->delayed_notifications);
   queue_free(channel->events);
   xfree(channel);
@@ -702,6 +826,7 @@ static Channel *register_channel(ChannelType type)
   rv->subscribed_events = pmap_new(cstr_t)();
   rv->next_request_id = 1;
   kv_init(rv->call_stack);
+  rv->async_calls = pmap_new(uint64_t)();
   kv_init(rv->delayed_notifications);
   pmap_put(uint64_t)(channels, rv->id, rv);
   return rv;
@@ -738,6 +863,78 @@ static void complete_call(msgpack_object *obj, Channel *channel)
   }
 }
 
+static void complete_async_call(msgpack_object *obj, Channel *channel)
+{
+  uint64_t request_id = obj->via.array.ptr[1].via.u64;
+  ChannelAsyncCall *call = pmap_get(uint64_t)(channel->async_calls,
+                                              request_id);
+  pmap_del(uint64_t)(channel->async_calls, request_id);
+  Error err = ERROR_INIT;
+  Object result = NIL;
+
+  if (obj->via.array.ptr[2].type != MSGPACK_OBJECT_NIL) {
+    Object error = NIL;
+    msgpack_rpc_to_object(&obj->via.array.ptr[2], &error);
+    set_error_from_response(error, &err);
+    api_free_object(error);
+  } else {
+    msgpack_rpc_to_object(&obj->via.array.ptr[3], &result);
+  }
+
+  call->cb(request_id, result, &err, call->data);
+  xfree(call);
+}
+
+// Completes all pending asynchronous calls with an error
+static void fail_async_calls(Channel *channel, char *msg)
+{
+  uint64_t request_id;
+  ChannelAsyncCall *call;
+  kvec_t(uint64_t) ids;
+  kv_init(ids);
+
+  map_foreach(channel->async_calls, request_id, call, {
+    kv_push(uint64_t, ids, request_id);
+  });
+
+  // Callbacks are invoked after collecting the ids, the map must not change
+  // while it is being iterated
+  for (size_t i = 0; i < kv_size(ids); i++) {
+    request_id = kv_A(ids, i);
+    call = pmap_get(uint64_t)(channel->async_calls, request_id);
+    pmap_del(uint64_t)(channel->async_calls, request_id);
+    Error err = ERROR_INIT;
+    api_set_error(&err, Exception, "%s", msg);
+    call->cb(request_id, NIL, &err, call->data);
+    xfree(call);
+  }
+
+  kv_destroy(ids);
+}
+
+// Converts the error object of a response into an `Error`
+static void set_error_from_response(Object result, Error *err)
+{
+  if (result.type == kObjectTypeString) {
+    api_set_error(err, Exception, "%s", result.data.string.data);
+  } else if (result.type == kObjectTypeArray) {
+    // Should be an error in the form [type, message]
+    Array array = result.data.array;
+    if (array.size == 2 && array.items[0].type == kObjectTypeInteger
+        && (array.items[0].data.integer == kErrorTypeException
+            || array.items[0].data.integer == kErrorTypeValidation)
+        && array.items[1].type == kObjectTypeString) {
+      err->type = (ErrorType) array.items[0].data.integer;
+      xstrlcpy(err->msg, array.items[1].data.string.data, sizeof(err->msg));
+      err->set = true;
+    } else {
+      api_set_error(err, Exception, "%s", "unknown error");
+    }
+  } else {
+    api_set_error(err, Exception, "%s", "unknown error");
+  }
+}
+
 static void call_set_error(Channel *channel, char *msg)
 {
   ELOG("msgpack-rpc: %s", msg);
@@ -748,6 +945,7 @@ static void call_set_error(Channel *channel, char *msg)
     frame->result = STRING_OBJ(cstr_to_string(msg));
   }
 
+  fail_async_calls(channel, msg);
   close_channel(channel);
 }
 
@@ -762,11 +960,7 @@ static WBuffer *serialize_request(uint64_t channel_id,
   msgpack_packer_init(&pac, sbuffer, msgpack_sbuffer_write);
   msgpack_rpc_serialize_request(request_id, method, args, &pac);
   log_server_msg(channel_id, sbuffer);
-  WBuffer *rv = wstream_new_buffer(xmemdup(sbuffer->data, sbuffer->size),
-                                   sbuffer->size,
-                                   refcount,
-                                   xfree);
-  msgpack_sbuffer_clear(sbuffer);
+  WBuffer *rv = sbuffer_to_wbuffer(sbuffer, refcount);
   api_free_array(args);
   return rv;
 }
@@ -781,12 +975,27 @@ static WBuffer *serialize_response(uint64_t channel_id,
   msgpack_packer_init(&pac, sbuffer, msgpack_sbuffer_write);
   msgpack_rpc_serialize_response(response_id, err, arg, &pac);
   log_server_msg(channel_id, sbuffer);
+  // responses only go though 1 channel
+  return sbuffer_to_wbuffer(sbuffer, 1);
+}
+
+// Moves the serialized data out of `sbuffer` into a new WBuffer. Big
+// messages take over the sbuffer memory instead of being copied, the sbuffer
+// allocates a fresh block for the next message.
+static WBuffer *sbuffer_to_wbuffer(msgpack_sbuffer *sbuffer, size_t refcount)
+{
+  if (sbuffer->size >= SBUFFER_HANDOFF_MIN) {
+    size_t size = sbuffer->size;
+    // msgpack allocates with the libc allocator
+    return wstream_new_buffer(msgpack_sbuffer_release(sbuffer), size,
+                              refcount, free);
+  }
+
   WBuffer *rv = wstream_new_buffer(xmemdup(sbuffer->data, sbuffer->size),
                                    sbuffer->size,
-                                   1,  // responses only go though 1 channel
+                                   refcount,
                                    xfree);
   msgpack_sbuffer_clear(sbuffer);
-  api_free_object(arg);
   return rv;
 }
 
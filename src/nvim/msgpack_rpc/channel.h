@@ -10,6 +10,17 @@
 
 #define METHOD_MAXLEN 512
 
+/// Called when the response to a `channel_send_async_call` request arrives.
+/// This runs while the event loop is polling, so it must not call into VimL
+/// directly.
+///
+/// @param request_id The id returned by `channel_send_async_call`
+/// @param result The result, owned by the callback. NIL if `err` is set.
+/// @param err The error returned by the remote method, if any
+/// @param data User-defined data
+typedef void (*channel_response_cb)(uint64_t request_id, Object result,
+    Error *err, void *data);
+
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "msgpack_rpc/channel.h.generated.h"
 #endif
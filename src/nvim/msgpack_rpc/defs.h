@@ -3,6 +3,8 @@
 
 #include <msgpack.h>
 
+#include "nvim/memory.h"
+
 
 /// The rpc_method_handlers table, used in msgpack_rpc_dispatch(), stores
 /// functions of this type.
@@ -10,9 +12,12 @@ typedef struct {
   Object (*fn)(uint64_t channel_id,
                uint64_t request_id,
                Array args,
+               Arena *arena,
                Error *error);
   bool async;  // function is always safe to run immediately instead of being
                // put in a request queue for handling when nvim waits for input.
+  bool arena_return;  // the result is allocated from `arena` if it isn't NULL,
+                      // so it must not be freed with `api_free_object`.
 } MsgpackRpcRequestHandler;
 
 /// Initializes the msgpack-rpc method table
@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <string.h>
 
 #include <msgpack.h>
 
@@ -92,20 +93,61 @@ bool msgpack_rpc_to_float(msgpack_object *obj, Float *arg)
 
 bool msgpack_rpc_to_string(msgpack_object *obj, String *arg)
   FUNC_ATTR_NONNULL_ALL
+{
+  return to_string(obj, arg, NULL);
+}
+
+bool msgpack_rpc_to_object(msgpack_object *obj, Object *arg)
+  FUNC_ATTR_NONNULL_ALL
+{
+  return to_object(obj, arg, NULL);
+}
+
+bool msgpack_rpc_to_array(msgpack_object *obj, Array *arg)
+  FUNC_ATTR_NONNULL_ALL
+{
+  return to_array(obj, arg, NULL);
+}
+
+bool msgpack_rpc_to_dictionary(msgpack_object *obj, Dictionary *arg)
+  FUNC_ATTR_NONNULL_ALL
+{
+  return to_dictionary(obj, arg, NULL);
+}
+
+/// Like `msgpack_rpc_to_array`, but the array and all nested objects are
+/// allocated from `arena`. The result must not be freed with
+/// `api_free_array`, it is released together with the arena.
+bool msgpack_rpc_to_array_arena(msgpack_object *obj, Array *arg, Arena *arena)
+  FUNC_ATTR_NONNULL_ALL
+{
+  return to_array(obj, arg, arena);
+}
+
+// Allocates from `arena` or from the heap if `arena` is NULL
+static void *to_alloc(Arena *arena, size_t size)
+{
+  return arena ? arena_alloc(arena, size, true) : xmalloc(size);
+}
+
+static bool to_string(msgpack_object *obj, String *arg, Arena *arena)
+  FUNC_ATTR_NONNULL_ARG(1, 2)
 {
   if (obj->type == MSGPACK_OBJECT_BIN || obj->type == MSGPACK_OBJECT_STR) {
     if (obj->via.bin.ptr == NULL) {
       return false;
     }
-    arg->data = xmemdupz(obj->via.bin.ptr, obj->via.bin.size);
+    arg->data = arena
+      ? arena_memdupz(arena, obj->via.bin.ptr, obj->via.bin.size)
+      : xmemdupz(obj->via.bin.ptr, obj->via.bin.size);
     arg->size = obj->via.bin.size;
     return true;
   }
   return false;
 }
 
-bool msgpack_rpc_to_object(msgpack_object *obj, Object *arg)
-  FUNC_ATTR_NONNULL_ALL
+static bool to_object(msgpack_object *obj, Object *arg, Arena *arena)
+  FUNC_ATTR_NONNULL_ARG(1, 2)
 {
   switch (obj->type) {
     case MSGPACK_OBJECT_NIL:
@@ -128,15 +170,15 @@ bool msgpack_rpc_to_object(msgpack_object *obj, Object *arg)
     case MSGPACK_OBJECT_BIN:
     case MSGPACK_OBJECT_STR:
       arg->type = kObjectTypeString;
-      return msgpack_rpc_to_string(obj, &arg->data.string);
+      return to_string(obj, &arg->data.string, arena);
 
     case MSGPACK_OBJECT_ARRAY:
       arg->type = kObjectTypeArray;
-      return msgpack_rpc_to_array(obj, &arg->data.array);
+      return to_array(obj, &arg->data.array, arena);
 
     case MSGPACK_OBJECT_MAP:
       arg->type = kObjectTypeDictionary;
-      return msgpack_rpc_to_dictionary(obj, &arg->data.dictionary);
+      return to_dictionary(obj, &arg->data.dictionary, arena);
 
     case MSGPACK_OBJECT_EXT:
       switch (obj->via.ext.type) {
@@ -155,18 +197,22 @@ bool msgpack_rpc_to_object(msgpack_object *obj, Object *arg)
   }
 }
 
-bool msgpack_rpc_to_array(msgpack_object *obj, Array *arg)
-  FUNC_ATTR_NONNULL_ALL
+static bool to_array(msgpack_object *obj, Array *arg, Arena *arena)
+  FUNC_ATTR_NONNULL_ARG(1, 2)
 {
   if (obj->type != MSGPACK_OBJECT_ARRAY) {
     return false;
   }
 
-  arg->size = obj->via.array.size;
-  arg->items = xcalloc(obj->via.array.size, sizeof(Object));
+  size_t size = obj->via.array.size;
+  arg->size = size;
+  arg->capacity = size;
+  // Items are zeroed so a partially converted array can be freed
+  arg->items = to_alloc(arena, (size ? size : 1) * sizeof(Object));
+  memset(arg->items, 0, (size ? size : 1) * sizeof(Object));
 
   for (uint32_t i = 0; i < obj->via.array.size; i++) {
-    if (!msgpack_rpc_to_object(obj->via.array.ptr + i, &arg->items[i])) {
+    if (!to_object(obj->via.array.ptr + i, &arg->items[i], arena)) {
       return false;
     }
   }
@@ -174,25 +220,25 @@ bool msgpack_rpc_to_array(msgpack_object *obj, Array *arg)
   return true;
 }
 
-bool msgpack_rpc_to_dictionary(msgpack_object *obj, Dictionary *arg)
-  FUNC_ATTR_NONNULL_ALL
+static bool to_dictionary(msgpack_object *obj, Dictionary *arg, Arena *arena)
+  FUNC_ATTR_NONNULL_ARG(1, 2)
 {
   if (obj->type != MSGPACK_OBJECT_MAP) {
     return false;
   }
 
-  arg->size = obj->via.array.size;
-  arg->items = xcalloc(obj->via.map.size, sizeof(KeyValuePair));
-
+  size_t size = obj->via.map.size;
+  arg->size = size;
+  arg->capacity = size;
+  arg->items = to_alloc(arena, (size ? size : 1) * sizeof(KeyValuePair));
+  memset(arg->items, 0, (size ? size : 1) * sizeof(KeyValuePair));
 
   for (uint32_t i = 0; i < obj->via.map.size; i++) {
-    if (!msgpack_rpc_to_string(&obj->via.map.ptr[i].key,
-          &arg->items[i].key)) {
+    if (!to_string(&obj->via.map.ptr[i].key, &arg->items[i].key, arena)) {
       return false;
     }
 
-    if (!msgpack_rpc_to_object(&obj->via.map.ptr[i].val,
-          &arg->items[i].value)) {
+    if (!to_object(&obj->via.map.ptr[i].val, &arg->items[i].value, arena)) {
       return false;
     }
   }
@@ -300,6 +346,7 @@ void msgpack_rpc_from_dictionary(Dictionary result, msgpack_packer *res)
 Object msgpack_rpc_handle_missing_method(uint64_t channel_id,
                                          uint64_t request_id,
                                          Array args,
+                                         Arena *arena,
                                          Error *error)
 {
   snprintf(error->msg, sizeof(error->msg), "Invalid method name");
@@ -311,6 +358,7 @@ Object msgpack_rpc_handle_missing_method(uint64_t channel_id,
 Object msgpack_rpc_handle_invalid_arguments(uint64_t channel_id,
                                             uint64_t request_id,
                                             Array args,
+                                            Arena *arena,
                                             Error *error)
 {
   snprintf(error->msg, sizeof(error->msg), "Invalid method arguments");
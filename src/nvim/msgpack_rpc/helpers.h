@@ -7,6 +7,7 @@
 #include <msgpack.h>
 
 #include "nvim/event/wstream.h"
+#include "nvim/memory.h"
 #include "nvim/api/private/defs.h"
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
@@ -2,6 +2,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "nvim/vim.h"
 #include "nvim/ui.h"
@@ -19,6 +20,20 @@
 typedef struct {
   uint64_t channel_id;
   Array buffer;
+  // State of the line based protocol(see `remote_ui_attach`)
+  bool linegrid;
+  PMap(uint64_t) *hl_ids;  // packed HlAttrs -> highlight id
+  int next_hl_id;
+  int hl_id;               // highlight id of the following "put" calls
+  int row, col;            // cursor position, as seen by the client
+  bool cursor_pending;     // a "cursor_goto" must be sent before other calls
+  bool line_pending;       // a "line" update is being built
+  int line_row, line_col;  // start of the pending "line" update
+  Array cells;             // committed cells of the pending "line" update
+  int cells_hl_id;         // highlight id of the last committed cell
+  String cell_text;        // cell that is being repeated
+  int cell_hl_id;
+  size_t cell_count;
 } UIData;
 
 static PMap(uint64_t) *connected_uis = NULL;
@@ -47,6 +62,11 @@ void remote_ui_disconnect(uint64_t channel_id)
   UIData *data = ui->data;
   // destroy pending screen updates
   api_free_array(data->buffer);
+  api_free_array(data->cells);
+  api_free_string(data->cell_text);
+  if (data->hl_ids) {
+    pmap_free(uint64_t)(data->hl_ids);
+  }
   pmap_del(uint64_t)(connected_uis, channel_id);
   xfree(ui->data);
   ui_detach(ui);
@@ -54,25 +74,50 @@ void remote_ui_disconnect(uint64_t channel_id)
 }
 
 static Object remote_ui_attach(uint64_t channel_id, uint64_t request_id,
-                               Array args, Error *error)
+                               Array args, Arena *arena, Error *error)
 {
   if (pmap_has(uint64_t)(connected_uis, channel_id)) {
     api_set_error(error, Exception, _("UI already attached for channel"));
     return NIL;
   }
 
-  if (args.size != 3 || args.items[0].type != kObjectTypeInteger
+  if (args.size < 3 || args.size > 4
+      || args.items[0].type != kObjectTypeInteger
       || args.items[1].type != kObjectTypeInteger
       || args.items[2].type != kObjectTypeBoolean
+      || (args.size == 4 && args.items[3].type != kObjectTypeDictionary)
       || args.items[0].data.integer <= 0 || args.items[1].data.integer <= 0) {
     api_set_error(error, Validation,
                   _("Invalid arguments. Expected: "
-                    "(uint width > 0, uint height > 0, bool enable_rgb)"));
+                    "(uint width > 0, uint height > 0, bool enable_rgb"
+                    "[, dict options])"));
     return NIL;
   }
-  UIData *data = xmalloc(sizeof(UIData));
+
+  bool linegrid = false;
+  if (args.size == 4) {
+    Dictionary opts = args.items[3].data.dictionary;
+    for (size_t i = 0; i < opts.size; i++) {
+      if (!strcmp(opts.items[i].key.data, "linegrid")
+          && opts.items[i].value.type == kObjectTypeBoolean) {
+        linegrid = opts.items[i].value.data.boolean;
+      } else {
+        api_set_error(error, Validation, _("Invalid UI option \"%s\""),
+                      opts.items[i].key.data);
+        return NIL;
+      }
+    }
+  }
+
+  UIData *data = xcalloc(1, sizeof(UIData));
   data->channel_id = channel_id;
   data->buffer = (Array)ARRAY_DICT_INIT;
+  data->cells = (Array)ARRAY_DICT_INIT;
+  data->linegrid = linegrid;
+  if (linegrid) {
+    data->hl_ids = pmap_new(uint64_t)();
+    data->next_hl_id = 1;
+  }
   UI *ui = xcalloc(1, sizeof(UI));
   ui->width = (int)args.items[0].data.integer;
   ui->height = (int)args.items[1].data.integer;
@@ -106,7 +151,7 @@ static Object remote_ui_attach(uint64_t channel_id, uint64_t request_id,
 }
 
 static Object remote_ui_detach(uint64_t channel_id, uint64_t request_id,
-                               Array args, Error *error)
+                               Array args, Arena *arena, Error *error)
 {
   if (!pmap_has(uint64_t)(connected_uis, channel_id)) {
     api_set_error(error, Exception, _("UI is not attached for channel"));
@@ -117,7 +162,7 @@ static Object remote_ui_detach(uint64_t channel_id, uint64_t request_id,
 }
 
 static Object remote_ui_try_resize(uint64_t channel_id, uint64_t request_id,
-                                   Array args, Error *error)
+                                   Array args, Arena *arena, Error *error)
 {
   if (!pmap_has(uint64_t)(connected_uis, channel_id)) {
     api_set_error(error, Exception, _("UI is not attached for channel"));
@@ -140,7 +185,34 @@ static Object remote_ui_try_resize(uint64_t channel_id, uint64_t request_id,
 }
 
 
+// With the "linegrid" option, the protocol differs from the default one:
+//
+// - "highlight_set" is never sent. Instead, each distinct set of attributes
+//   is announced once with `["hl_attr_define", [id, attrs]]` and the id is
+//   referenced by the cells of following "line" updates. Id 0 is the default
+//   highlight and is never defined.
+// - Consecutive "put" calls are sent as a single
+//   `["line", [row, col, cells]]` update, where each item of `cells` is
+//   `[text, hl_id, repeat]`. `hl_id` may be omitted if it is the same as the
+//   one of the previous cell in the update, `repeat` may be omitted if it is
+//   1(it can only be present if `hl_id` is). An empty text is the right half
+//   of a double width character. After an update the cursor is positioned
+//   after its last cell.
+// - "cursor_goto" is only sent when the position is needed by the next call,
+//   since "line" updates carry their own position.
 static void push_call(UI *ui, char *name, Array args)
+{
+  UIData *data = ui->data;
+
+  if (data->linegrid) {
+    flush_line(ui);
+    flush_cursor_goto(ui);
+  }
+
+  add_call(ui, name, args);
+}
+
+static void add_call(UI *ui, char *name, Array args)
 {
   Array call = ARRAY_DICT_INIT;
   UIData *data = ui->data;
@@ -164,10 +236,16 @@ static void push_call(UI *ui, char *name, Array args)
 
 static void remote_ui_resize(UI *ui, int width, int height)
 {
+  UIData *data = ui->data;
   Array args = ARRAY_DICT_INIT;
   ADD(args, INTEGER_OBJ(width));
   ADD(args, INTEGER_OBJ(height));
   push_call(ui, "resize", args);
+  if (data->linegrid) {
+    // The client moves the cursor to the top-left corner when resizing
+    data->row = data->col = 0;
+    data->cursor_pending = false;
+  }
 }
 
 static void remote_ui_clear(UI *ui)
@@ -184,6 +262,15 @@ static void remote_ui_eol_clear(UI *ui)
 
 static void remote_ui_cursor_goto(UI *ui, int row, int col)
 {
+  UIData *data = ui->data;
+  if (data->linegrid) {
+    flush_line(ui);
+    data->row = row;
+    data->col = col;
+    data->cursor_pending = true;
+    return;
+  }
+
   Array args = ARRAY_DICT_INIT;
   ADD(args, INTEGER_OBJ(row));
   ADD(args, INTEGER_OBJ(col));
@@ -254,7 +341,19 @@ static void remote_ui_scroll(UI *ui, int count)
 
 static void remote_ui_highlight_set(UI *ui, HlAttrs attrs)
 {
+  UIData *data = ui->data;
+  if (data->linegrid) {
+    data->hl_id = get_hl_id(ui, attrs);
+    return;
+  }
+
   Array args = ARRAY_DICT_INIT;
+  ADD(args, DICTIONARY_OBJ(hlattrs2dict(attrs)));
+  push_call(ui, "highlight_set", args);
+}
+
+static Dictionary hlattrs2dict(HlAttrs attrs)
+{
   Dictionary hl = ARRAY_DICT_INIT;
 
   if (attrs.bold) {
@@ -285,12 +384,49 @@ static void remote_ui_highlight_set(UI *ui, HlAttrs attrs)
     PUT(hl, "background", INTEGER_OBJ(attrs.background));
   }
 
-  ADD(args, DICTIONARY_OBJ(hl));
-  push_call(ui, "highlight_set", args);
+  return hl;
+}
+
+// Returns the highlight id for `attrs`, defining a new one if necessary.
+static int get_hl_id(UI *ui, HlAttrs attrs)
+{
+  UIData *data = ui->data;
+  // Colors are 24-bit RGB values(or 8-bit terminal colors) or -1, so the
+  // whole set of attributes can be packed in a single key
+  uint64_t key = (uint64_t)(attrs.foreground + 1) & 0x1ffffff;
+  key |= ((uint64_t)(attrs.background + 1) & 0x1ffffff) << 25;
+  key |= (uint64_t)attrs.bold << 50 | (uint64_t)attrs.underline << 51
+      | (uint64_t)attrs.undercurl << 52 | (uint64_t)attrs.italic << 53
+      | (uint64_t)attrs.reverse << 54;
+
+  if (!key) {
+    // default attributes
+    return 0;
+  }
+
+  int id = (int)(uintptr_t)pmap_get(uint64_t)(data->hl_ids, key);
+  if (!id) {
+    id = data->next_hl_id++;
+    pmap_put(uint64_t)(data->hl_ids, key, (void *)(uintptr_t)id);
+    Array args = ARRAY_DICT_INIT;
+    ADD(args, INTEGER_OBJ(id));
+    ADD(args, DICTIONARY_OBJ(hlattrs2dict(attrs)));
+    // Definitions don't depend on the cursor or on pending cells, so they
+    // don't interrupt the line update being built.
+    add_call(ui, "hl_attr_define", args);
+  }
+
+  return id;
 }
 
 static void remote_ui_put(UI *ui, uint8_t *data, size_t size)
 {
+  UIData *uidata = ui->data;
+  if (uidata->linegrid) {
+    line_put(ui, data, size);
+    return;
+  }
+
   Array args = ARRAY_DICT_INIT;
   String str = {.data = xmemdupz(data, size), .size = size};
   ADD(args, STRING_OBJ(str));
@@ -326,6 +462,10 @@ static void remote_ui_update_bg(UI *ui, int bg)
 static void remote_ui_flush(UI *ui)
 {
   UIData *data = ui->data;
+  if (data->linegrid) {
+    flush_line(ui);
+    flush_cursor_goto(ui);
+  }
   channel_send_event(data->channel_id, "redraw", data->buffer);
   data->buffer = (Array)ARRAY_DICT_INIT;
 }
@@ -349,3 +489,89 @@ static void remote_ui_set_icon(UI *ui, char *icon)
   ADD(args, STRING_OBJ(cstr_to_string(icon)));
   push_call(ui, "set_icon", args);
 }
+
+// Adds a cell to the pending "line" update, starting one if necessary.
+static void line_put(UI *ui, uint8_t *str, size_t size)
+{
+  UIData *data = ui->data;
+
+  if (!data->line_pending) {
+    // The update carries the position, so a pending "cursor_goto" is
+    // redundant
+    data->cursor_pending = false;
+    data->line_pending = true;
+    data->line_row = data->row;
+    data->line_col = data->col;
+    data->cells_hl_id = -1;
+  } else if (data->cell_count && data->cell_hl_id == data->hl_id
+             && data->cell_text.size == size
+             && (!size || !memcmp(data->cell_text.data, str, size))) {
+    // Same as the previous cell, just increase the repeat count
+    data->cell_count++;
+    data->col++;
+    return;
+  }
+
+  commit_cell(ui);
+  data->cell_text = size
+    ? (String) {.data = xmemdupz(str, size), .size = size}
+    : cstr_to_string("");
+  data->cell_hl_id = data->hl_id;
+  data->cell_count = 1;
+  data->col++;
+}
+
+// Appends the cell being repeated to the pending "line" update.
+static void commit_cell(UI *ui)
+{
+  UIData *data = ui->data;
+  if (!data->cell_count) {
+    return;
+  }
+
+  Array cell = ARRAY_DICT_INIT;
+  ADD(cell, STRING_OBJ(data->cell_text));
+  if (data->cell_hl_id != data->cells_hl_id || data->cell_count > 1) {
+    ADD(cell, INTEGER_OBJ(data->cell_hl_id));
+  }
+  if (data->cell_count > 1) {
+    ADD(cell, INTEGER_OBJ((Integer)data->cell_count));
+  }
+  ADD(data->cells, ARRAY_OBJ(cell));
+  data->cells_hl_id = data->cell_hl_id;
+  data->cell_text = (String)STRING_INIT;
+  data->cell_count = 0;
+}
+
+// Sends the pending "line" update, if any.
+static void flush_line(UI *ui)
+{
+  UIData *data = ui->data;
+  if (!data->line_pending) {
+    return;
+  }
+
+  commit_cell(ui);
+  data->line_pending = false;
+  Array args = ARRAY_DICT_INIT;
+  ADD(args, INTEGER_OBJ(data->line_row));
+  ADD(args, INTEGER_OBJ(data->line_col));
+  ADD(args, ARRAY_OBJ(data->cells));
+  data->cells = (Array)ARRAY_DICT_INIT;
+  add_call(ui, "line", args);
+}
+
+// Sends the cursor position if the client doesn't know it yet.
+static void flush_cursor_goto(UI *ui)
+{
+  UIData *data = ui->data;
+  if (!data->cursor_pending) {
+    return;
+  }
+
+  data->cursor_pending = false;
+  Array args = ARRAY_DICT_INIT;
+  ADD(args, INTEGER_OBJ(data->row));
+  ADD(args, INTEGER_OBJ(data->col));
+  add_call(ui, "cursor_goto", args);
+}
@@ -3750,6 +3750,11 @@ set_num_option (
     }
     if (p_uc && !old_value)
       ml_open_files();
+  } else if (pp == &p_pgs) {
+    if (p_pgs < MIN_SWAP_PAGE_SIZE || p_pgs > MAX_SWAP_PAGE_SIZE) {
+      errmsg = e_invarg;
+      p_pgs = old_value;
+    }
   } else if (pp == &curwin->w_p_cole) {
     if (curwin->w_p_cole < 0) {
       errmsg = e_positive;
@@ -267,6 +267,7 @@
 
 EXTERN long p_aleph;            /* 'aleph' */
 EXTERN bool p_acd;              /* 'autochdir' */
+EXTERN int p_afs;               /* 'asyncfsync' */
 EXTERN char_u   *p_ambw;        /* 'ambiwidth' */
 EXTERN int p_ar;                /* 'autoread' */
 EXTERN int p_aw;                /* 'autowrite' */
@@ -439,12 +440,14 @@ EXTERN long p_mmp;              /* 'maxmempattern' */
 EXTERN long p_mmt;              /* 'maxmemtot' */
 EXTERN long p_mis;              /* 'menuitems' */
 EXTERN char_u   *p_msm;         /* 'mkspellmem' */
+EXTERN long p_mms;              /* 'mmapsize' */
 EXTERN long p_mls;              /* 'modelines' */
 EXTERN char_u   *p_mouse;       /* 'mouse' */
 EXTERN char_u   *p_mousem;      /* 'mousemodel' */
 EXTERN long p_mouset;           /* 'mousetime' */
 EXTERN int p_more;              /* 'more' */
 EXTERN char_u   *p_opfunc;      /* 'operatorfunc' */
+EXTERN long p_pgs;              /* 'pagesize' */
 EXTERN char_u   *p_para;        /* 'paragraphs' */
 EXTERN int p_paste;             /* 'paste' */
 EXTERN char_u   *p_pt;          /* 'pastetoggle' */
@@ -99,6 +99,15 @@ return {
       varname='p_ambw',
       defaults={if_true={vi="single"}}
     },
+    {
+      full_name='asyncfsync', abbreviation='afs',
+      type='bool', scope={'global'},
+      secure=true,
+      vi_def=true,
+      enable_if='HAVE_FSYNC',
+      varname='p_afs',
+      defaults={if_true={vi=false}}
+    },
     {
       full_name='autochdir', abbreviation='acd',
       type='bool', scope={'global'},
@@ -1532,6 +1541,13 @@ return {
       varname='p_msm',
       defaults={if_true={vi="460000,2000,500"}}
     },
+    {
+      full_name='mmapsize', abbreviation='mms',
+      type='number', scope={'global'},
+      vi_def=true,
+      varname='p_mms',
+      defaults={if_true={vi=102400}}
+    },
     {
       full_name='modeline', abbreviation='ml',
       type='bool', scope={'buffer'},
@@ -1657,6 +1673,13 @@ return {
       varname='p_opfunc',
       defaults={if_true={vi=""}}
     },
+    {
+      full_name='pagesize', abbreviation='pgs',
+      type='number', scope={'global'},
+      vi_def=true,
+      varname='p_pgs',
+      defaults={if_true={vi=4096}}
+    },
     {
       full_name='paragraphs', abbreviation='para',
       type='string', scope={'global'},
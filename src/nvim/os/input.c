@@ -18,7 +18,9 @@
 #include "nvim/ex_cmds2.h"
 #include "nvim/getchar.h"
 #include "nvim/main.h"
+#include "nvim/memline.h"
 #include "nvim/misc1.h"
+#include "nvim/syntax.h"
 
 #define READ_BUFFER_SIZE 0xfff
 #define INPUT_BUFFER_SIZE (READ_BUFFER_SIZE * 4)
@@ -96,7 +98,12 @@ int os_inchar(uint8_t *buf, int maxlen, int ms, int tb_change_cnt)
       }
 
       before_blocking();
-      result = inbuf_poll(-1);
+      // Do idle work in slices, handling events in between.
+      while (idle_work() && (result = inbuf_poll(0)) == kInputNone) {
+      }
+      if (result == kInputNone) {
+        result = inbuf_poll(-1);
+      }
     }
   }
 
@@ -123,6 +130,14 @@ int os_inchar(uint8_t *buf, int maxlen, int ms, int tb_change_cnt)
   return 0;
 }
 
+// Compacts memlines and parses syntax ahead while waiting for a character.
+// Returns true when there is more to do.
+static bool idle_work(void)
+{
+  bool more = ml_compact_all();
+  return syn_parse_ahead() || more;
+}
+
 // Check if a character is available for reading
 bool os_char_avail(void)
 {
@@ -7029,6 +7029,15 @@ void vim_regfree(regprog_T *prog)
     prog->engine->regfree(prog);
 }
 
+/*
+ * Return the name of the engine used by "prog": "nfa" or "backtracking".
+ * This may change when a pattern is too complex for the NFA engine.
+ */
+char *vim_regengine_name(regprog_T *prog)
+{
+  return prog->engine == &nfa_regengine ? "nfa" : "backtracking";
+}
+
 static void report_re_switch(char_u *pat)
 {
   if (p_verbose > 0) {
@@ -48,6 +48,7 @@
 #include "nvim/terminal.h"
 #include "nvim/ui.h"
 #include "nvim/os/os.h"
+#include "nvim/os/input.h"
 #include "nvim/os/time.h"
 
 // Structure that stores information about a highlight group.
@@ -369,6 +370,10 @@ static int current_line_id = 0;         /* unique number for current line */
 #define CUR_STATE(idx)  ((stateitem_T *)(current_state.ga_data))[idx]
 
 static int syn_time_on = FALSE;
+
+/* Time limit for parsing ahead, NULL when not parsing ahead.  Then
+ * syntax_start() checks it between lines. */
+static proftime_T *syn_ahead_tm = NULL;
 # define IF_SYN_TIME(p) (p)
 
 
@@ -441,13 +446,26 @@ void syntax_start(win_T *wp, linenr_T lnum)
    * Only do this if lnum is not before and not to far beyond a saved state.
    */
   if (INVALID_STATE(&current_state) && syn_block->b_sst_array != NULL) {
-    /* Find last valid saved state before start_lnum. */
-    for (p = syn_block->b_sst_first; p != NULL; p = p->sst_next) {
+    /* Find last valid saved state before start_lnum.  A valid state is
+     * exact, use it when syn_sync() would start parsing before it anyway.
+     * Start at the last found entry when it is valid, there can't be a
+     * better one before it. */
+    linenr_T min_lnum = lnum - syn_sync_lines();
+    if (min_lnum > lnum - syn_block->b_syn_sync_minlines)
+      min_lnum = lnum - syn_block->b_syn_sync_minlines;
+    /* When parsing ahead continue from any valid state, it is where the
+     * previous slice stopped. */
+    if (syn_ahead_tm != NULL)
+      min_lnum = 0;
+    p = syn_block->b_sst_hint;
+    if (p == NULL || p->sst_lnum > lnum || p->sst_change_lnum != 0)
+      p = syn_block->b_sst_first;
+    for (; p != NULL; p = p->sst_next) {
       if (p->sst_lnum > lnum)
         break;
       if (p->sst_lnum <= lnum && p->sst_change_lnum == 0) {
         last_valid = p;
-        if (p->sst_lnum >= lnum - syn_block->b_syn_sync_minlines)
+        if (p->sst_lnum >= min_lnum)
           last_min_valid = p;
       }
     }
@@ -524,6 +542,16 @@ void syntax_start(win_T *wp, linenr_T lnum)
         prev = store_current_state();
     }
 
+    /* When parsing ahead stop between lines when the time is up or a
+     * character was typed.  Store the state to continue from here. */
+    if (syn_ahead_tm != NULL && current_lnum < lnum
+        && (profile_passed_limit(*syn_ahead_tm) || os_char_avail())) {
+      if (current_lnum >= first_stored
+          && (prev == NULL || prev->sst_lnum != current_lnum))
+        (void)store_current_state();
+      break;
+    }
+
     /* This can take a long time: break when CTRL-C pressed.  The current
      * state will be wrong then. */
     line_breakcheck();
@@ -561,6 +589,31 @@ static void clear_current_state(void)
   GA_DEEP_CLEAR(&current_state, stateitem_T, UNREF_STATEITEM_EXTMATCH);
 }
 
+/*
+ * Return the number of lines above a line where syn_sync() starts parsing.
+ * Start further back than "minlines", to avoid that scrolling backwards will
+ * result in resyncing for every line.  Now it resyncs only one out of N
+ * lines, where N is minlines * 1.5, or minlines * 2 if minlines is small.
+ * Watch out for overflow when minlines is MAXLNUM.
+ */
+static linenr_T syn_sync_lines(void)
+{
+  linenr_T n;
+
+  if (syn_block->b_syn_sync_minlines == 1)
+    n = 1;
+  else if (syn_block->b_syn_sync_minlines < 10)
+    n = syn_block->b_syn_sync_minlines * 2;
+  else if (syn_block->b_syn_sync_minlines > MAXLNUM / 3 * 2)
+    n = MAXLNUM;
+  else
+    n = syn_block->b_syn_sync_minlines * 3 / 2;
+  if (syn_block->b_syn_sync_maxlines != 0
+      && n > syn_block->b_syn_sync_maxlines)
+    n = syn_block->b_syn_sync_maxlines;
+  return n;
+}
+
 /*
  * Try to find a synchronisation point for line "lnum".
  *
@@ -598,23 +651,11 @@ static void syn_sync(win_T *wp, linenr_T start_lnum, synstate_T *last_valid)
   /*
    * Start at least "minlines" back.  Default starting point for parsing is
    * there.
-   * Start further back, to avoid that scrolling backwards will result in
-   * resyncing for every line.  Now it resyncs only one out of N lines,
-   * where N is minlines * 1.5, or minlines * 2 if minlines is small.
-   * Watch out for overflow when minlines is MAXLNUM.
    */
   if (syn_block->b_syn_sync_minlines > start_lnum)
     start_lnum = 1;
   else {
-    if (syn_block->b_syn_sync_minlines == 1)
-      lnum = 1;
-    else if (syn_block->b_syn_sync_minlines < 10)
-      lnum = syn_block->b_syn_sync_minlines * 2;
-    else
-      lnum = syn_block->b_syn_sync_minlines * 3 / 2;
-    if (syn_block->b_syn_sync_maxlines != 0
-        && lnum > syn_block->b_syn_sync_maxlines)
-      lnum = syn_block->b_syn_sync_maxlines;
+    lnum = syn_sync_lines();
     if (lnum >= start_lnum)
       start_lnum = 1;
     else
@@ -952,6 +993,14 @@ static void syn_update_ends(int startofline)
  * entries depends on the number of lines in the buffer.  For small buffers
  * the distance is fixed at SST_DIST, for large buffers there is a fixed
  * number of entries SST_MAX_ENTRIES, and the distance is computed.
+ *
+ * b_sst_hint remembers the entry last found.  Lines are mostly parsed from
+ * top to bottom, searching the list starts there to avoid walking over all
+ * the entries above it for every line.
+ *
+ * When waiting for the user to type, syn_parse_ahead() parses the lines of
+ * the displayed buffers in slices, storing entries on the way.  Jumping to a
+ * far away line then only needs to parse from a nearby entry.
  */
 
 static void syn_stack_free_block(synblock_T *block)
@@ -964,6 +1013,8 @@ static void syn_stack_free_block(synblock_T *block)
     xfree(block->b_sst_array);
     block->b_sst_array = NULL;
     block->b_sst_len = 0;
+    block->b_sst_hint = NULL;
+    block->b_sst_ahead_lnum = 0;
   }
 }
 /*
@@ -1049,6 +1100,7 @@ static void syn_stack_alloc(void)
     xfree(syn_block->b_sst_array);
     syn_block->b_sst_array = sstp;
     syn_block->b_sst_len = len;
+    syn_block->b_sst_hint = NULL;
   }
 }
 
@@ -1077,8 +1129,20 @@ static void syn_stack_apply_changes_block(synblock_T *block, buf_T *buf)
   if (block->b_sst_array == NULL)       /* nothing to do */
     return;
 
-  prev = NULL;
-  for (p = block->b_sst_first; p != NULL; ) {
+  /* Parsing ahead has to be done again from the change on. */
+  if (block->b_sst_ahead_lnum >= buf->b_mod_top)
+    block->b_sst_ahead_lnum = buf->b_mod_top - 1;
+
+  /* Entries before the last found one are not affected when it isn't. */
+  prev = block->b_sst_hint;
+  if (prev != NULL
+      && prev->sst_lnum + block->b_syn_sync_linebreaks <= buf->b_mod_top)
+    p = prev->sst_next;
+  else {
+    prev = NULL;
+    p = block->b_sst_first;
+  }
+  while (p != NULL) {
     if (p->sst_lnum + block->b_syn_sync_linebreaks > buf->b_mod_top) {
       n = p->sst_lnum + buf->b_mod_xlines;
       if (n <= buf->b_mod_bot) {
@@ -1175,6 +1239,8 @@ static int syn_stack_cleanup(void)
  */
 static void syn_stack_free_entry(synblock_T *block, synstate_T *p)
 {
+  if (block->b_sst_hint == p)
+    block->b_sst_hint = NULL;
   clear_syn_state(p);
   p->sst_next = block->b_sst_firstfree;
   block->b_sst_firstfree = p;
@@ -1184,18 +1250,27 @@ static void syn_stack_free_entry(synblock_T *block, synstate_T *p)
 /*
  * Find an entry in the list of state stacks at or before "lnum".
  * Returns NULL when there is no entry or the first entry is after "lnum".
+ * Lines are mostly parsed top to bottom, thus the search starts at the entry
+ * found last time when possible.
  */
 static synstate_T *syn_stack_find_entry(linenr_T lnum)
 {
   synstate_T  *p, *prev;
 
   prev = NULL;
-  for (p = syn_block->b_sst_first; p != NULL; prev = p, p = p->sst_next) {
-    if (p->sst_lnum == lnum)
-      return p;
+  p = syn_block->b_sst_hint;
+  if (p == NULL || p->sst_lnum > lnum)
+    p = syn_block->b_sst_first;
+  for (; p != NULL; prev = p, p = p->sst_next) {
+    if (p->sst_lnum == lnum) {
+      prev = p;
+      break;
+    }
     if (p->sst_lnum > lnum)
       break;
   }
+  if (prev != NULL)
+    syn_block->b_sst_hint = prev;
   return prev;
 }
 
@@ -1232,10 +1307,8 @@ static synstate_T *store_current_state(void)
         syn_block->b_sst_first = sp->sst_next;
       else {
         /* find the entry just before this one to adjust sst_next */
-        for (p = syn_block->b_sst_first; p != NULL; p = p->sst_next)
-          if (p->sst_next == sp)
-            break;
-        if (p != NULL)          /* just in case */
+        p = syn_stack_find_entry(sp->sst_lnum - 1);
+        if (p != NULL && p->sst_next == sp)     /* just in case */
           p->sst_next = sp->sst_next;
       }
       syn_stack_free_entry(syn_block, sp);
@@ -1409,6 +1482,44 @@ static int syn_stack_equal(synstate_T *sp)
   return FALSE;
 }
 
+/*
+ * Parse the syntax of the buffers in the current tab page ahead, filling the
+ * state stack cache.  Used when waiting for a character.  Works in slices of
+ * about SST_AHEAD_MSEC msec, the time and typeahead are checked between
+ * lines.
+ * Returns TRUE when there are more lines to parse.
+ */
+int syn_parse_ahead(void)
+{
+  proftime_T tm = profile_setlimit(SST_AHEAD_MSEC);
+
+  FOR_ALL_WINDOWS_IN_TAB(wp, curtab) {
+    synblock_T *block = wp->w_s;
+    buf_T *buf = wp->w_buffer;
+
+    /* Stored states are only valid after changes have been applied when
+     * redrawing. */
+    if (!syntax_present(wp) || block->b_syn_error || buf->b_mod_set)
+      continue;
+    while (block->b_sst_ahead_lnum < buf->b_ml.ml_line_count) {
+      if (profile_passed_limit(tm) || os_char_avail())
+        return TRUE;
+      linenr_T lnum = block->b_sst_ahead_lnum + SST_AHEAD_LINES;
+      if (lnum > buf->b_ml.ml_line_count)
+        lnum = buf->b_ml.ml_line_count;
+      syn_ahead_tm = &tm;
+      syntax_start(wp, lnum);
+      syn_ahead_tm = NULL;
+      if (got_int || block->b_sst_array == NULL)
+        return FALSE;
+      // syntax_start() may have stopped before "lnum" when out of time.
+      if (current_lnum > block->b_sst_ahead_lnum)
+        block->b_sst_ahead_lnum = current_lnum;
+    }
+  }
+  return FALSE;
+}
+
 /*
  * We stop parsing syntax above line "lnum".  If the stored state at or below
  * this line depended on a change before it, it now depends on the line below
@@ -5660,6 +5771,34 @@ char_u *get_syntime_arg(expand_T *xp, int idx)
   return NULL;
 }
 
+/*
+ * Add a Dictionary to "list" for each syntax pattern of window "wp", with the
+ * timing measured since ":syntime on".  Used by getsyntime() and
+ * window_get_syntime().
+ */
+void syntime_list(win_T *wp, list_T *list)
+{
+  static char *type_names[] = { "", "match", "start", "end", "skip" };
+
+  for (int idx = 0; idx < wp->w_s->b_syn_patterns.ga_len; ++idx) {
+    synpat_T *spp = &(SYN_ITEMS(wp->w_s)[idx]);
+    dict_T *dict = dict_alloc();
+
+    dict_add_nr_str(dict, "name", 0L, HL_TABLE()[spp->sp_syn.id - 1].sg_name);
+    dict_add_nr_str(dict, "pattern", 0L, spp->sp_pattern);
+    dict_add_nr_str(dict, "type", 0L, (char_u *)type_names[spp->sp_type]);
+    dict_add_nr_str(dict, "engine", 0L, spp->sp_prog == NULL ? (char_u *)""
+                    : (char_u *)vim_regengine_name(spp->sp_prog));
+    dict_add_nr_str(dict, "count", spp->sp_time.count, NULL);
+    dict_add_nr_str(dict, "match", spp->sp_time.match, NULL);
+    dict_add_float(dict, "total",
+                   (float_T)spp->sp_time.total / 1000000000.0);
+    dict_add_float(dict, "slowest",
+                   (float_T)spp->sp_time.slowest / 1000000000.0);
+    list_append_dict(list, dict);
+  }
+}
+
 static int syn_compare_syntime(const void *v1, const void *v2)
 {
   const time_entry_T  *s1 = v1;
@@ -6,9 +6,11 @@
 typedef int32_t RgbValue;
 
 # define SST_MIN_ENTRIES 150    /* minimal size for state stack array */
-# define SST_MAX_ENTRIES 1000   /* maximal size for state stack array */
+# define SST_MAX_ENTRIES 8000   /* maximal size for state stack array */
 # define SST_FIX_STATES  7      /* size of sst_stack[]. */
 # define SST_DIST        16     /* normal distance between entries */
+# define SST_AHEAD_LINES 500    /* max lines parsed ahead per syntax_start() */
+# define SST_AHEAD_MSEC  20     /* msec spent parsing ahead per slice */
 # define SST_INVALID    (synstate_T *)-1        /* invalid syn_state pointer */
 
 typedef unsigned short disptick_T;      /* display tick type */
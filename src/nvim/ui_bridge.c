@@ -10,6 +10,7 @@
 #include "nvim/memory.h"
 #include "nvim/ui_bridge.h"
 #include "nvim/ugrid.h"
+#include "nvim/os/time.h"
 
 #ifdef INCLUDE_GENERATED_DECLARATIONS
 # include "ui_bridge.c.generated.h"
@@ -17,10 +18,17 @@
 
 #define UI(b) (((UIBridgeData *)b)->ui)
 
-// Call a function in the UI thread
+// Schedule a function call in the UI thread
+#define UI_SCHEDULE(ui, name, argc, ...)                                  \
+  ring_push((UIBridgeData *)ui,                                           \
+            event_create(1, ui_bridge_##name##_event, argc, __VA_ARGS__))
+
+// Call a function in the UI thread, after any buffered cells
 #define UI_CALL(ui, name, argc, ...)                                      \
-  ((UIBridgeData *)ui)->scheduler(                                        \
-    event_create(1, ui_bridge_##name##_event, argc, __VA_ARGS__), UI(ui))
+  do {                                                                    \
+    flush_cells(ui);                                                      \
+    UI_SCHEDULE(ui, name, argc, __VA_ARGS__);                             \
+  } while (0)
 
 #define INT2PTR(i) ((void *)(uintptr_t)i)
 #define PTR2INT(p) ((int)(uintptr_t)p)
@@ -74,6 +82,44 @@ UI *ui_bridge_attach(UI *ui, ui_main_fn ui_main, event_scheduler scheduler)
   return &rv->bridge;
 }
 
+// Pushes an event to the ring. The UI thread is only woken up(through the
+// scheduler) when the ring was empty, otherwise the drain that is already
+// pending or running will pick the event up.
+static void ring_push(UIBridgeData *bridge, Event event)
+{
+  size_t w = __atomic_load_n(&bridge->ring_write, __ATOMIC_RELAXED);
+  while (w - __atomic_load_n(&bridge->ring_read, __ATOMIC_ACQUIRE)
+         == UI_BRIDGE_RING_SIZE) {
+    // Full, wait for the UI thread to catch up
+    os_microdelay(50);
+  }
+
+  bridge->ring[w & (UI_BRIDGE_RING_SIZE - 1)] = event;
+  __atomic_store_n(&bridge->ring_write, w + 1, __ATOMIC_SEQ_CST);
+
+  // Sequentially consistent accesses on both sides guarantee that either the
+  // drain sees the new write index after releasing its last slot, or this
+  // load sees that the ring was empty. Both can happen, which only results
+  // in an extra(empty) drain.
+  if (__atomic_load_n(&bridge->ring_read, __ATOMIC_SEQ_CST) == w) {
+    bridge->scheduler(event_create(1, ring_drain_event, 1, bridge),
+                      bridge->ui);
+  }
+}
+
+// Runs all events in the ring, executed in the UI thread
+static void ring_drain_event(void **argv)
+{
+  UIBridgeData *bridge = argv[0];
+  size_t r = __atomic_load_n(&bridge->ring_read, __ATOMIC_RELAXED);
+
+  while (r != __atomic_load_n(&bridge->ring_write, __ATOMIC_SEQ_CST)) {
+    Event event = bridge->ring[r & (UI_BRIDGE_RING_SIZE - 1)];
+    event.handler(event.argv);
+    __atomic_store_n(&bridge->ring_read, ++r, __ATOMIC_SEQ_CST);
+  }
+}
+
 static void ui_thread_run(void *data)
 {
   UIBridgeData *bridge = data;
@@ -88,6 +134,7 @@ static void ui_bridge_stop(UI *b)
   uv_mutex_destroy(&bridge->mutex);
   uv_cond_destroy(&bridge->cond);
   ui_detach(b);
+  kv_destroy(bridge->cells);
   xfree(b);
 }
 static void ui_bridge_stop_event(void **argv)
@@ -221,31 +268,55 @@ static void ui_bridge_scroll_event(void **argv)
 
 static void ui_bridge_highlight_set(UI *b, HlAttrs attrs)
 {
-  HlAttrs *a = xmalloc(sizeof(HlAttrs));
-  *a = attrs;
-  UI_CALL(b, highlight_set, 2, b, a);
-}
-static void ui_bridge_highlight_set_event(void **argv)
-{
-  UI *ui = UI(argv[0]);
-  ui->highlight_set(ui, *((HlAttrs *)argv[1]));
-  xfree(argv[1]);
+  UIBridgeData *bridge = (UIBridgeData *)b;
+  UIBridgeCell *cell = kv_pushp(UIBridgeCell, bridge->cells);
+  cell->is_hl = true;
+  cell->data.attrs = attrs;
 }
 
 static void ui_bridge_put(UI *b, uint8_t *text, size_t size)
 {
-  uint8_t *t = NULL;
+  UIBridgeData *bridge = (UIBridgeData *)b;
+  UIBridgeCell *cell = kv_pushp(UIBridgeCell, bridge->cells);
+  cell->is_hl = false;
+  cell->size = text ? size : 0;
   if (text) {
-    t = xmalloc(sizeof(((UCell *)0)->data));
-    memcpy(t, text, size);
+    assert(size <= sizeof(cell->data.text));
+    memcpy(cell->data.text, text, size);
   }
-  UI_CALL(b, put, 3, b, t, INT2PTR(size));
 }
-static void ui_bridge_put_event(void **argv)
+
+// Hand the buffered cells to the UI thread
+static void flush_cells(UI *b)
+{
+  UIBridgeData *bridge = (UIBridgeData *)b;
+  size_t size = kv_size(bridge->cells);
+  if (!size) {
+    return;
+  }
+
+  UIBridgeCell *cells = bridge->cells.items;
+  kv_init(bridge->cells);
+  // Consecutive batches usually have similar sizes(screen rows), so reserve
+  // space for the next one upfront.
+  kv_resize(UIBridgeCell, bridge->cells, MAX(size, bridge->last_cells_size));
+  bridge->last_cells_size = size;
+  UI_SCHEDULE(b, cells, 3, b, cells, (void *)(uintptr_t)size);
+}
+static void ui_bridge_cells_event(void **argv)
 {
   UI *ui = UI(argv[0]);
-  ui->put(ui, (uint8_t *)argv[1], (size_t)(uintptr_t)argv[2]);
-  xfree(argv[1]);
+  UIBridgeCell *cells = argv[1];
+  size_t size = (size_t)(uintptr_t)argv[2];
+  for (size_t i = 0; i < size; i++) {
+    UIBridgeCell *cell = cells + i;
+    if (cell->is_hl) {
+      ui->highlight_set(ui, cell->data.attrs);
+    } else {
+      ui->put(ui, cell->size ? cell->data.text : NULL, cell->size);
+    }
+  }
+  xfree(cells);
 }
 
 static void ui_bridge_bell(UI *b)
@@ -5,7 +5,22 @@
 #include <uv.h>
 
 #include "nvim/ui.h"
+#include "nvim/ugrid.h"
 #include "nvim/event/defs.h"
+#include "nvim/lib/kvec.h"
+
+// A buffered "put" or "highlight_set" call
+typedef struct {
+  bool is_hl;
+  size_t size;  // 0 is a "put" with NULL text
+  union {
+    uint8_t text[sizeof(((UCell *)0)->data)];
+    HlAttrs attrs;
+  } data;
+} UIBridgeCell;
+
+// Capacity of the event ring, must be a power of two
+#define UI_BRIDGE_RING_SIZE 1024
 
 typedef struct ui_bridge_data UIBridgeData;
 typedef void(*ui_main_fn)(UIBridgeData *bridge, UI *ui);
@@ -22,6 +37,15 @@ struct ui_bridge_data {
   // the call returns. This flag is used as a condition for the main
   // thread to continue.
   bool ready;
+  // Cells drawn since the last call of another kind. They are handed to the
+  // UI thread in a single event, which normally means once per screen row.
+  kvec_t(UIBridgeCell) cells;
+  size_t last_cells_size;
+  // Single-producer/single-consumer ring of events sent from the main
+  // thread to the UI thread. `ring_write` is only modified by the main
+  // thread and `ring_read` by the UI thread, both are accessed atomically.
+  Event ring[UI_BRIDGE_RING_SIZE];
+  size_t ring_read, ring_write;
 };
 
 #define CONTINUE(b)                                                    \
@@ -336,7 +336,6 @@ static long get_undolevel(void)
  */
 int u_savecommon(linenr_T top, linenr_T bot, linenr_T newbot, int reload)
 {
-  linenr_T lnum;
   long i;
   u_header_T  *uhp;
   u_header_T  *old_curhead;
@@ -572,15 +571,12 @@ int u_savecommon(linenr_T top, linenr_T bot, linenr_T newbot, int reload)
   }
 
   if (size > 0) {
-    uep->ue_array = xmalloc(sizeof(char_u *) * (size_t)size);
-    for (i = 0, lnum = top + 1; i < size; ++i) {
-      fast_breakcheck();
-      if (got_int) {
-        u_freeentry(uep, i);
-        return FAIL;
-      }
-      uep->ue_array[i] = u_save_line(lnum++);
+    fast_breakcheck();
+    if (got_int) {
+      u_freeentry(uep);
+      return FAIL;
     }
+    uep->ue_array = u_save_lines(top + 1, size);
   } else
     uep->ue_array = NULL;
   uep->ue_next = curbuf->b_u_newhead->uh_entry;
@@ -595,6 +591,14 @@ int u_savecommon(linenr_T top, linenr_T bot, linenr_T newbot, int reload)
 }
 
 
+/*
+ * Use fseeko() and ftello() when available, off_t can be bigger than long.
+ */
+#ifdef HAVE_FSEEKO
+# define fseek fseeko
+# define ftell ftello
+#endif
+
 # define UF_START_MAGIC     "Vim\237UnDo\345"  /* magic at start of undofile */
 # define UF_START_MAGIC_LEN     9
 # define UF_HEADER_MAGIC        0x5fd0  /* magic at start of header */
@@ -709,7 +713,7 @@ static void u_free_uhp(u_header_T *uhp)
   uep = uhp->uh_entry;
   while (uep != NULL) {
     nuep = uep->ue_next;
-    u_freeentry(uep, uep->ue_size);
+    u_freeentry(uep);
     uep = nuep;
   }
   xfree(uhp);
@@ -917,33 +921,168 @@ static u_entry_T *unserialize_uep(bufinfo_T * bi, bool *error, char_u *file_name
   uep->ue_lcount = undo_read_4c(bi);
   uep->ue_size = undo_read_4c(bi);
 
-  char_u **array;
-  if (uep->ue_size > 0) {
-    array = xmalloc(sizeof(char_u *) * (size_t)uep->ue_size);
-    memset(array, 0, sizeof(char_u *) * (size_t)uep->ue_size);
-  } else {
-    array = NULL;
+  if (uep->ue_size <= 0) {
+    uep->ue_size = 0;
+    return uep;
   }
-  uep->ue_array = array;
 
-  for (size_t i = 0; i < (size_t)uep->ue_size; i++) {
+  // Skip the lines, u_load_lines() reads them when they are needed.
+  uep->ue_offset = ftell(bi->bi_fp);
+  for (long i = 0; i < uep->ue_size; i++) {
     int line_len = undo_read_4c(bi);
-    char_u *line;
-    if (line_len >= 0) {
-      line = undo_read_string(bi, (size_t)line_len);
-    } else {
-      line = NULL;
+    if (line_len < 0 || fseek(bi->bi_fp, line_len, SEEK_CUR) != 0) {
       corruption_error("line length", file_name);
-    }
-    if (line == NULL) {
+      uep->ue_size = 0;
+      uep->ue_offset = 0;
       *error = true;
-      return uep;
+      break;
     }
-    array[i] = line;
   }
   return uep;
 }
 
+/// Reads the lines of "uep" at the current position of the undo file.
+///
+/// @returns false in case of an error.
+static bool unserialize_lines(bufinfo_T *bi, u_entry_T *uep, char_u *file_name)
+{
+  // First find the size of the text, then read the lines into the line
+  // array at once.
+  long start = ftell(bi->bi_fp);
+  size_t textlen = 0;
+  for (long i = 0; i < uep->ue_size; i++) {
+    int line_len = undo_read_4c(bi);
+    if (line_len < 0 || fseek(bi->bi_fp, line_len, SEEK_CUR) != 0) {
+      corruption_error("line length", file_name);
+      return false;
+    }
+    textlen += (size_t)line_len + 1;
+  }
+  if (start < 0 || fseek(bi->bi_fp, start, SEEK_SET) != 0) {
+    return false;
+  }
+
+  char_u **array = u_alloc_lines(uep->ue_size, textlen);
+  char_u *p = (char_u *)(array + uep->ue_size);
+  size_t left = textlen;
+  for (long i = 0; i < uep->ue_size; i++) {
+    int line_len = undo_read_4c(bi);
+    // The length must be the same as above.
+    if (line_len < 0 || (size_t)line_len >= left
+        || (line_len > 0 && !undo_read(bi, p, (size_t)line_len))) {
+      corruption_error("line length", file_name);
+      xfree(array);
+      return false;
+    }
+    array[i] = p;
+    p[line_len] = NUL;
+    p += line_len + 1;
+    left -= (size_t)line_len + 1;
+  }
+  uep->ue_array = array;
+  return true;
+}
+
+/// Reads the header of the undo file that u_load_lines() reads the lines
+/// from and checks that it is the one u_read_undo() read.
+///
+/// @returns false when it differs or cannot be read.
+static bool unserialize_lazy_header(bufinfo_T *bi)
+{
+  buf_T *buf = bi->bi_buf;
+  char_u magic_buf[UF_START_MAGIC_LEN];
+  char_u read_hash[UNDO_HASH_SIZE];
+
+  if (!undo_read(bi, magic_buf, UF_START_MAGIC_LEN)
+      || memcmp(magic_buf, UF_START_MAGIC, UF_START_MAGIC_LEN) != 0
+      || undo_read_2c(bi) != UF_VERSION
+      || !undo_read(bi, read_hash, UNDO_HASH_SIZE)
+      || memcmp(read_hash, buf->b_u_lazy_hash, UNDO_HASH_SIZE) != 0) {
+    return false;
+  }
+  (void)undo_read_4c(bi);  // line count
+  // Skip the text for the "U" command, line number and column.
+  int str_len = undo_read_4c(bi);
+  if (str_len < 0 || fseek(bi->bi_fp, (long)str_len + 8, SEEK_CUR) != 0) {
+    return false;
+  }
+  // Skip old, new and current header sequence numbers and the header count.
+  for (int i = 0; i < 4; i++) {
+    (void)undo_read_4c(bi);
+  }
+  return undo_read_4c(bi) == buf->b_u_lazy_seq_last;
+}
+
+/// Reads the lines of the undo entries of "buf" that u_read_undo() skipped.
+///
+/// This is done when the lines are first needed, for all entries at once.
+/// When the undo file changed in the meantime the undo information is
+/// dropped.
+static void u_load_lines(buf_T *buf)
+{
+  char_u *file_name = buf->b_u_lazy_name;
+  if (file_name == NULL) {
+    return;
+  }
+  buf->b_u_lazy_name = NULL;
+
+  bool ok = false;
+  FileInfo file_info;
+  FILE *fp = NULL;
+  if (os_fileinfo((char *)file_name, &file_info)
+      && os_fileinfo_id_equal(&file_info, &buf->b_u_lazy_info)
+      && os_fileinfo_size(&file_info) == os_fileinfo_size(&buf->b_u_lazy_info)
+      && file_info.stat.st_mtim.tv_sec
+         == buf->b_u_lazy_info.stat.st_mtim.tv_sec
+      && file_info.stat.st_mtim.tv_nsec
+         == buf->b_u_lazy_info.stat.st_mtim.tv_nsec
+      && (fp = mch_fopen((char *)file_name, "r")) != NULL) {
+    bufinfo_T bi;
+    bi.bi_buf = buf;
+    bi.bi_fp = fp;
+    // The offsets are only valid for the file that u_read_undo() read.
+    ok = unserialize_lazy_header(&bi);
+
+    // Visit all headers, like u_write_undo() does.
+    int mark = ++lastmark;
+    u_header_T *uhp = buf->b_u_oldhead;
+    while (ok && uhp != NULL) {
+      if (uhp->uh_walk != mark) {
+        uhp->uh_walk = mark;
+        for (u_entry_T *uep = uhp->uh_entry; ok && uep != NULL;
+             uep = uep->ue_next) {
+          if (uep->ue_offset != 0) {
+            ok = fseek(fp, uep->ue_offset, SEEK_SET) == 0
+                 && unserialize_lines(&bi, uep, file_name);
+            uep->ue_offset = 0;
+          }
+        }
+      }
+
+      if (uhp->uh_prev.ptr != NULL && uhp->uh_prev.ptr->uh_walk != mark)
+        uhp = uhp->uh_prev.ptr;
+      else if (uhp->uh_alt_next.ptr != NULL
+               && uhp->uh_alt_next.ptr->uh_walk != mark)
+        uhp = uhp->uh_alt_next.ptr;
+      else if (uhp->uh_next.ptr != NULL && uhp->uh_alt_prev.ptr == NULL
+               && uhp->uh_next.ptr->uh_walk != mark)
+        uhp = uhp->uh_next.ptr;
+      else if (uhp->uh_alt_prev.ptr != NULL)
+        uhp = uhp->uh_alt_prev.ptr;
+      else
+        uhp = uhp->uh_next.ptr;
+    }
+    fclose(fp);
+  }
+
+  if (!ok) {
+    EMSG2(_("E822: Cannot open undo file for reading: %s"), file_name);
+    u_blockfree(buf);
+    u_clearall(buf);
+  }
+  xfree(file_name);
+}
+
 /// Serializes "pos".
 static void serialize_pos(bufinfo_T *bi, pos_T pos)
 {
@@ -1023,6 +1162,9 @@ void u_write_undo(char_u *name, int forceit, buf_T *buf, char_u *hash)
   } else
     file_name = name;
 
+  // The lines not read yet come from the undo file that is replaced.
+  u_load_lines(buf);
+
   /*
    * Decide about the permission to use for the undo file.  If the buffer
    * has a name use the permission of the original file.  Otherwise only
@@ -1206,6 +1348,35 @@ theend:
     xfree(file_name);
 }
 
+/// Compares undo headers by sequence number, for qsort().
+static int uhp_seq_cmp(const void *a, const void *b)
+{
+  long seq_a = (*(u_header_T *const *)a)->uh_seq;
+  long seq_b = (*(u_header_T *const *)b)->uh_seq;
+  return seq_a < seq_b ? -1 : seq_a > seq_b;
+}
+
+/// Finds the header with sequence number "seq" in "uhp_table", which is
+/// sorted by sequence number.
+///
+/// @returns the index of the header or -1 when not found.
+static int uhp_table_find(u_header_T **uhp_table, int num_head, long seq)
+{
+  int low = 0;
+  int high = num_head - 1;
+  while (low <= high) {
+    int mid = low + (high - low) / 2;
+    if (uhp_table[mid]->uh_seq < seq) {
+      low = mid + 1;
+    } else if (uhp_table[mid]->uh_seq > seq) {
+      high = mid - 1;
+    } else {
+      return mid;
+    }
+  }
+  return -1;
+}
+
 /// Loads the undo tree from an undo file.
 /// If "name" is not NULL use it as the undo file name. This also means being
 /// a bit more verbose.
@@ -1259,6 +1430,11 @@ void u_read_undo(char_u *name, char_u *hash, char_u *orig_name)
     }
     goto error;
   }
+  FileInfo file_info;
+  if (!os_fileinfo_fd(fileno(fp), &file_info)) {
+    EMSG2(_("E822: Cannot open undo file for reading: %s"), file_name);
+    goto error;
+  }
 
   bufinfo_T bi;
   bi.bi_buf = curbuf;
@@ -1346,8 +1522,8 @@ void u_read_undo(char_u *name, char_u *hash, char_u *orig_name)
   }
 
   // uhp_table will store the freshly created undo headers we allocate
-  // until we insert them into curbuf. The table remains sorted by the
-  // sequence numbers of the headers.
+  // until we insert them into curbuf. Once all headers are read the table
+  // is sorted by their sequence numbers.
   // When there are no headers uhp_table is NULL.
   if (num_head > 0) {
     uhp_table = xmalloc((size_t)num_head * sizeof(u_header_T *));
@@ -1387,53 +1563,36 @@ void u_read_undo(char_u *name, char_u *hash, char_u *orig_name)
 # define SET_FLAG(j)
 #endif
 
-  // We have put all of the headers into a table. Now we iterate through the
-  // table and swizzle each sequence number we have stored in uh_*_seq into
-  // a pointer corresponding to the header with that sequence number.
+  // We have put all of the headers into a table. Now we sort the table by
+  // sequence number and swizzle each sequence number we have stored in
+  // uh_*_seq into a pointer corresponding to the header with that sequence
+  // number, found with a binary search.
+  if (num_head > 0) {
+    qsort(uhp_table, (size_t)num_head, sizeof(u_header_T *), uhp_seq_cmp);
+  }
   short old_idx = -1, new_idx = -1, cur_idx = -1;
   for (int i = 0; i < num_head; i++) {
     u_header_T *uhp = uhp_table[i];
-    if (uhp == NULL) {
-      continue;
-    }
-    for (int j = 0; j < num_head; j++) {
-      if (uhp_table[j] != NULL && i != j
-          && uhp_table[i]->uh_seq == uhp_table[j]->uh_seq) {
-        corruption_error("duplicate uh_seq", file_name);
-        goto error;
-      }
+    if (i > 0 && uhp_table[i - 1]->uh_seq == uhp->uh_seq) {
+      corruption_error("duplicate uh_seq", file_name);
+      goto error;
     }
-    for (int j = 0; j < num_head; j++) {
-      if (uhp_table[j] != NULL
-          && uhp_table[j]->uh_seq == uhp->uh_next.seq) {
-        uhp->uh_next.ptr = uhp_table[j];
-        SET_FLAG(j);
-        break;
-      }
+    int j;
+    if ((j = uhp_table_find(uhp_table, num_head, uhp->uh_next.seq)) >= 0) {
+      uhp->uh_next.ptr = uhp_table[j];
+      SET_FLAG(j);
     }
-    for (int j = 0; j < num_head; j++) {
-      if (uhp_table[j] != NULL
-          && uhp_table[j]->uh_seq == uhp->uh_prev.seq) {
-        uhp->uh_prev.ptr = uhp_table[j];
-        SET_FLAG(j);
-        break;
-      }
+    if ((j = uhp_table_find(uhp_table, num_head, uhp->uh_prev.seq)) >= 0) {
+      uhp->uh_prev.ptr = uhp_table[j];
+      SET_FLAG(j);
     }
-    for (int j = 0; j < num_head; j++) {
-      if (uhp_table[j] != NULL
-          && uhp_table[j]->uh_seq == uhp->uh_alt_next.seq) {
-        uhp->uh_alt_next.ptr = uhp_table[j];
-        SET_FLAG(j);
-        break;
-      }
+    if ((j = uhp_table_find(uhp_table, num_head, uhp->uh_alt_next.seq)) >= 0) {
+      uhp->uh_alt_next.ptr = uhp_table[j];
+      SET_FLAG(j);
     }
-    for (int j = 0; j < num_head; j++) {
-      if (uhp_table[j] != NULL
-          && uhp_table[j]->uh_seq == uhp->uh_alt_prev.seq) {
-        uhp->uh_alt_prev.ptr = uhp_table[j];
-        SET_FLAG(j);
-        break;
-      }
+    if ((j = uhp_table_find(uhp_table, num_head, uhp->uh_alt_prev.seq)) >= 0) {
+      uhp->uh_alt_prev.ptr = uhp_table[j];
+      SET_FLAG(j);
     }
     if (old_header_seq > 0 && old_idx < 0 && uhp->uh_seq == old_header_seq) {
       assert(i <= SHRT_MAX);
@@ -1467,6 +1626,12 @@ void u_read_undo(char_u *name, char_u *hash, char_u *orig_name)
   curbuf->b_u_time_cur = seq_time;
   curbuf->b_u_save_nr_last = last_save_nr;
   curbuf->b_u_save_nr_cur = last_save_nr;
+  // Use the full name, the current directory may change before the lines
+  // are read.
+  curbuf->b_u_lazy_name = (char_u *)FullName_save((char *)file_name, false);
+  curbuf->b_u_lazy_info = file_info;
+  memcpy(curbuf->b_u_lazy_hash, read_hash, UNDO_HASH_SIZE);
+  curbuf->b_u_lazy_seq_last = seq_last;
 
   curbuf->b_u_synced = true;
   xfree(uhp_table);
@@ -1638,6 +1803,7 @@ static void u_doit(int startcount)
      * before we do anything, because it may change curbuf->b_u_curhead
      * and more. */
     change_warning(0);
+    u_load_lines(curbuf);
 
     if (undo_undoes) {
       if (curbuf->b_u_curhead == NULL)                  /* first undo */
@@ -1709,6 +1875,7 @@ void undo_time(long step, int sec, int file, int absolute)
   /* First make sure the current undoable change is synced. */
   if (curbuf->b_u_synced == false)
     u_sync(TRUE);
+  u_load_lines(curbuf);
 
   u_newcount = 0;
   u_oldcount = 0;
@@ -2081,11 +2248,9 @@ static void u_undoredo(int undo)
 
     /* delete the lines between top and bot and save them in newarray */
     if (oldsize > 0) {
-      newarray = xmalloc(sizeof(char_u *) * (size_t)oldsize);
+      newarray = u_save_lines(top + 1, oldsize);
       /* delete backwards, it goes faster in most cases */
       for (lnum = bot - 1, i = oldsize; --i >= 0; --lnum) {
-        /* what can we do when we run out of memory? */
-        newarray[i] = u_save_line(lnum);
         /* remember we deleted the last line in the buffer, and a
          * dummy empty line will be inserted */
         if (curbuf->b_ml.ml_line_count == 1)
@@ -2106,7 +2271,6 @@ static void u_undoredo(int undo)
           ml_replace((linenr_T)1, uep->ue_array[i], TRUE);
         else
           ml_append(lnum, uep->ue_array[i], (colnr_T)0, FALSE);
-        xfree(uep->ue_array[i]);
       }
       xfree((char_u *)uep->ue_array);
     }
@@ -2469,6 +2633,10 @@ void u_find_first_changed(void)
 
   if (curbuf->b_u_curhead != NULL || uhp == NULL)
     return;      /* undid something in an autocmd? */
+  u_load_lines(curbuf);
+  uhp = curbuf->b_u_newhead;
+  if (uhp == NULL)
+    return;
 
   /* Check that the last undo block was for the whole file. */
   uep = uhp->uh_entry;
@@ -2661,7 +2829,7 @@ u_freeentries (
 
   for (uep = uhp->uh_entry; uep != NULL; uep = nuep) {
     nuep = uep->ue_next;
-    u_freeentry(uep, uep->ue_size);
+    u_freeentry(uep);
   }
 
 #ifdef U_DEBUG
@@ -2672,12 +2840,10 @@ u_freeentries (
 }
 
 /*
- * free entry 'uep' and 'n' lines in uep->ue_array[]
+ * free entry 'uep' and the lines in uep->ue_array[]
  */
-static void u_freeentry(u_entry_T *uep, long n)
+static void u_freeentry(u_entry_T *uep)
 {
-  while (n > 0)
-    xfree(uep->ue_array[--n]);
   xfree((char_u *)uep->ue_array);
 #ifdef U_DEBUG
   uep->ue_magic = 0;
@@ -2695,6 +2861,7 @@ void u_clearall(buf_T *buf)
   buf->b_u_numhead = 0;
   buf->b_u_line_ptr = NULL;
   buf->b_u_line_lnum = 0;
+  buf->b_u_lazy_name = NULL;
 }
 
 /*
@@ -2780,6 +2947,45 @@ void u_blockfree(buf_T *buf)
     assert(buf->b_u_oldhead != previous_oldhead);
   }
   xfree(buf->b_u_line_ptr);
+  xfree(buf->b_u_lazy_name);
+}
+
+/// Allocates the line array of an undo entry: "size" line pointers followed
+/// by "textlen" bytes for the text of the lines, in a single block.
+///
+/// Freeing the array frees the lines as well.
+static char_u **u_alloc_lines(long size, size_t textlen)
+{
+  return xmalloc(sizeof(char_u *) * (size_t)size + textlen);
+}
+
+/// Copies "size" lines starting at "lnum" of the current buffer into a line
+/// array from u_alloc_lines().
+static char_u **u_save_lines(linenr_T lnum, long size)
+{
+  MemlineIter iter;
+  char_u *line;
+  size_t len;
+  size_t textlen = 0;
+
+  // The line lengths come from the data blocks, first find the total size.
+  ml_iter_init(&iter, curbuf, lnum, lnum + size - 1);
+  while (ml_iter_next(&iter, &line, &len)) {
+    textlen += len + 1;
+  }
+
+  char_u **array = u_alloc_lines(size, textlen);
+  char_u *p = (char_u *)(array + size);
+  long i = 0;
+  ml_iter_init(&iter, curbuf, lnum, lnum + size - 1);
+  while (ml_iter_next(&iter, &line, &len)) {
+    array[i++] = p;
+    memcpy(p, line, len);
+    p[len] = NUL;
+    p += len + 1;
+  }
+  assert(i == size);
+  return array;
 }
 
 /*
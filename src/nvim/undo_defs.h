@@ -2,6 +2,7 @@
 #define NVIM_UNDO_DEFS_H
 
 #include <time.h>  // for time_t
+#include <sys/types.h>  // for off_t
 
 #include "nvim/pos.h"
 #include "nvim/buffer_defs.h"
@@ -21,8 +22,11 @@ struct u_entry {
   linenr_T ue_top;              /* number of line above undo block */
   linenr_T ue_bot;              /* number of line below undo block */
   linenr_T ue_lcount;           /* linecount when u_save called */
-  char_u      **ue_array;       /* array of lines in undo block */
+  char_u      **ue_array;       /* array of lines in undo block, the text
+                                   follows the array in the same block */
   long ue_size;                 /* number of lines in ue_array */
+  off_t ue_offset;              /* when not zero: offset of the lines in the
+                                   undo file, they were not read yet */
 #ifdef U_DEBUG
   int ue_magic;                 /* magic number to check allocation */
 #endif
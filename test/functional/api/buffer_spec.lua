@@ -3,6 +3,7 @@ local helpers = require('test.functional.helpers')
 local clear, nvim, buffer, curbuf, curwin, eq, ok =
   helpers.clear, helpers.nvim, helpers.buffer, helpers.curbuf, helpers.curwin,
   helpers.eq, helpers.ok
+local next_message = helpers.next_message
 
 describe('buffer_* functions', function()
   before_each(clear)
@@ -68,6 +69,80 @@ describe('buffer_* functions', function()
       eq({}, curbuf('get_line_slice', -4, -5, true, true))
     end)
 
+    it('set_line_slice: shrinks ranges spanning many blocks', function()
+      local lines = {}
+      for i = 1, 2000 do
+        lines[i] = 'line '..i
+      end
+      curbuf('set_line_slice', 0, -1, true, true, lines)
+      curbuf('set_line_slice', 5, 1994, true, true, {'x', 'y'})
+      eq(12, curbuf('line_count'))
+      eq({'line 5', 'x', 'y', 'line 1996', 'line 1997', 'line 1998'},
+         curbuf('get_line_slice', 4, 9, true, true))
+      -- byte offsets are kept in sync
+      eq(#'line 1\nline 2\nline 3\nline 4\nline 5\n' + 1,
+         nvim('eval', 'line2byte(6)'))
+      eq(7 * 5 + 2 * 2 + #'line 1996\n' + 1, nvim('eval', 'line2byte(9)'))
+      nvim('command', 'undo')
+      eq(2000, curbuf('line_count'))
+      eq('line 1500', curbuf('get_line', 1499))
+    end)
+
+    it('set_line_slice: grows ranges spanning many blocks', function()
+      local lines = {}
+      for i = 1, 2000 do
+        lines[i] = 'line '..i
+      end
+      curbuf('set_line_slice', 0, -1, true, true, lines)
+      local new = {}
+      for i = 1, 3000 do
+        new[i] = ('x'):rep(i % 5)..i
+      end
+      curbuf('set_line_slice', 10, 11, true, true, new)
+      local expected = {}
+      for i = 1, 10 do
+        expected[#expected + 1] = lines[i]
+      end
+      for i = 1, 3000 do
+        expected[#expected + 1] = new[i]
+      end
+      for i = 13, 2000 do
+        expected[#expected + 1] = lines[i]
+      end
+      eq(expected, curbuf('get_line_slice', 0, -1, true, true))
+      -- byte offsets are kept in sync
+      local offset = 1
+      for i = 1, #expected do
+        if i % 500 == 0 then
+          eq(offset, nvim('eval', 'line2byte('..i..')'))
+        end
+        offset = offset + #expected[i] + 1
+      end
+      nvim('command', 'undo')
+      eq(lines, curbuf('get_line_slice', 0, -1, true, true))
+    end)
+
+    it('get_line_slice: reads ranges spanning many blocks', function()
+      local lines = {}
+      for i = 1, 2000 do
+        lines[i] = ('x'):rep(i % 7)..i
+      end
+      curbuf('set_line_slice', 0, -1, true, true, lines)
+      -- the changed line is only held in memory, not in its data block
+      nvim('command', 'call setline(1000, "changed")')
+      lines[1000] = 'changed'
+      eq(lines, curbuf('get_line_slice', 0, -1, true, true))
+      eq({lines[999], 'changed', lines[1001]},
+         nvim('eval', 'getline(999, 1001)'))
+      -- alternate with reads from another buffer
+      nvim('command', 'new')
+      nvim('eval', 'setline(1, ["a", "bb"])')
+      for _, l in ipairs({1, 1999, 3, 1500}) do
+        eq({lines[l]}, nvim('eval', 'getbufline(1, '..l..')'))
+        eq({'bb'}, nvim('eval', 'getline(2, 2)'))
+      end
+    end)
+
     it('set_line_slice: out-of-bounds is an error', function()
       curbuf('set_line_slice', 0, 0, true, true, {'a', 'b', 'c'})
       eq({'a', 'b', 'c'}, curbuf('get_line_slice', 0, 2, true, true)) --sanity
@@ -155,4 +230,34 @@ describe('buffer_* functions', function()
       eq({3, 0}, curbuf('get_mark', 'V'))
     end)
   end)
+
+  describe('attach', function()
+    -- Skips the buffer handle and changedtick
+    local function next_lines_event()
+      local msg = next_message()
+      eq('notification', msg[1])
+      eq('buffer_lines_event', msg[2])
+      return {msg[3][3], msg[3][4], msg[3][5]}
+    end
+
+    it('sends line changes', function()
+      curbuf('set_line_slice', 0, -1, true, true, {'a', 'b', 'c'})
+      curbuf('attach', true)
+      eq({0, -1, {'a', 'b', 'c'}}, next_lines_event())
+      curbuf('set_line', 1, 'x')
+      eq({1, 2, {'x'}}, next_lines_event())
+      nvim('command', 'normal! ggdd')
+      eq({0, 1, {}}, next_lines_event())
+      curbuf('insert', -1, {'d'})
+      eq({2, 2, {'d'}}, next_lines_event())
+    end)
+
+    it('sends a detach event', function()
+      curbuf('attach', false)
+      curbuf('detach')
+      local msg = next_message()
+      eq('notification', msg[1])
+      eq('buffer_detach_event', msg[2])
+    end)
+  end)
 end)
@@ -4,7 +4,7 @@
 local helpers = require('test.functional.helpers')
 local clear, nvim, eval = helpers.clear, helpers.nvim, helpers.eval
 local eq, neq, run, stop = helpers.eq, helpers.neq, helpers.run, helpers.stop
-local nvim_prog = helpers.nvim_prog
+local nvim_prog, source = helpers.nvim_prog, helpers.source
 
 
 describe('server -> client', function()
@@ -67,6 +67,87 @@ describe('server -> client', function()
     end)
   end)
 
+  describe('async call', function()
+    it('keeps several requests in flight', function()
+      local results = {}
+      local function on_setup()
+        source([[
+          function! OnResult(handle, result, error)
+            call rpcnotify(]]..cid..[[, "result", a:result)
+          endfunction
+        ]])
+        nvim('command', 'call rpcasync('..cid..', "acall", [1], "OnResult")')
+        nvim('command', 'call rpcasync('..cid..', "acall", [2], "OnResult")')
+      end
+
+      local function on_request(method, args)
+        eq('acall', method)
+        return args[1] * 10
+      end
+
+      local function on_notification(method, args)
+        eq('result', method)
+        table.insert(results, args[1])
+        if #results == 2 then
+          stop()
+        end
+      end
+
+      run(on_request, on_notification, on_setup)
+      table.sort(results)
+      eq({10, 20}, results)
+    end)
+
+    it('returns the result with rpcwait()', function()
+      local function on_setup()
+        eq(30, eval('rpcwait(rpcasync('..cid..', "acall", [3]))'))
+        stop()
+      end
+
+      local function on_request(method, args)
+        eq('acall', method)
+        return args[1] * 10
+      end
+      run(on_request, nil, on_setup)
+    end)
+
+    it('drops the oldest result that is not collected', function()
+      local function on_setup()
+        nvim('command', 'let g:handles = map(range(1001), '
+                        ..'"rpcasync('..cid..', \'acall\', [v:val])")')
+        eq(10000, eval('rpcwait(g:handles[1000])'))
+        eq(false, pcall(eval, 'rpcwait(g:handles[0])'))
+        eq(10, eval('rpcwait(g:handles[1], 0)'))
+        stop()
+      end
+
+      local function on_request(method, args)
+        eq('acall', method)
+        return args[1] * 10
+      end
+      run(on_request, nil, on_setup)
+    end)
+
+    it('keeps the result rpcwait() is waiting for', function()
+      local function on_setup()
+        -- The results arrive while rpcwait() is blocked on the oldest one,
+        -- which must not be dropped when the limit is passed
+        nvim('command', 'let g:handles = map(range(1001), '
+                        ..'"rpcasync('..cid..', \'acall\', [v:val])")'
+                        ..' | let g:first = rpcwait(g:handles[0])')
+        eq(0, eval('g:first'))
+        eq(10000, eval('rpcwait(g:handles[1000])'))
+        stop()
+      end
+
+      local function on_request(method, args)
+        eq('acall', method)
+        return args[1] * 10
+      end
+      run(on_request, nil, on_setup)
+    end)
+  end)
+
   describe('requests and notifications interleaved', function()
     -- This tests that the following scenario won't happen:
     --
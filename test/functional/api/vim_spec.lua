@@ -45,6 +45,42 @@ describe('vim_* functions', function()
     end)
   end)
 
+  describe('call_atomic', function()
+    it('works', function()
+      nvim('command', 'let g:a = 1')
+      local rv = nvim('call_atomic', {
+        {'vim_set_var', {'b', 2}},
+        {'vim_get_var', {'a'}},
+        {'vim_eval', {'g:a + g:b'}},
+      })
+      eq(1, rv[1][2])
+      eq(3, rv[1][3])
+      eq(nil, rv[2])
+    end)
+
+    it('stops at the first error', function()
+      local rv = nvim('call_atomic', {
+        {'vim_set_var', {'c', 3}},
+        {'vim_get_var', {'doesnotexist'}},
+        {'vim_set_var', {'d', 4}},
+      })
+      eq(1, rv[2][1])
+      eq(3, nvim('get_var', 'c'))
+      eq(false, pcall(nvim, 'get_var', 'd'))
+    end)
+
+    it('executes nothing if a call is malformed', function()
+      nvim('set_current_line', 'before')
+      eq(false, pcall(nvim, 'call_atomic', {
+        {'vim_set_current_line', {'after'}},
+        {'vim_set_var', {'e', 5}},
+        42,
+      }))
+      eq('before', nvim('get_current_line'))
+      eq(false, pcall(nvim, 'get_var', 'e'))
+    end)
+  end)
+
   describe('strwidth', function()
     it('works', function()
       eq(3, nvim('strwidth', 'abc'))
@@ -178,6 +178,27 @@ describe('window_* functions', function()
     end)
   end)
 
+  describe('get_syntime', function()
+    it('works', function()
+      insert('foo bar foo')
+      nvim('command', 'syntax match Foo /foo/')
+      nvim('command', 'syntax region Bar start=/bar/ end=/$/')
+      nvim('command', 'syntime on')
+      eval('synID(1, 1, 1) + synID(1, 5, 1)')
+      local times = curwin('get_syntime')
+      eq(eval('getsyntime()'), times)
+      eq(3, #times)
+      eq({'Foo', 'foo', 'match'},
+         {times[1].name, times[1].pattern, times[1].type})
+      eq({'start', 'end'}, {times[2].type, times[3].type})
+      ok(times[1].count > 0 and times[1].match > 0)
+      ok(times[1].total >= times[1].slowest)
+      eq('nfa', times[1].engine)
+      nvim('command', 'new')
+      eq({}, curwin('get_syntime'))
+    end)
+  end)
+
   describe('is_valid', function()
     it('works', function()
       nvim('command', 'split')
@@ -0,0 +1,69 @@
+local helpers = require('test.functional.helpers')
+local clear, execute, eq, eval = helpers.clear, helpers.execute, helpers.eq,
+  helpers.eval
+local write_file, curbuf = helpers.write_file, helpers.curbuf
+
+describe("'mmapsize'", function()
+  local fname = 'Xtest-mmapsize'
+  local lines
+
+  before_each(function()
+    clear()
+    execute('set mmapsize=1')
+    lines = {}
+    for i = 1, 500 do
+      lines[i] = 'line '..i
+    end
+  end)
+
+  after_each(function()
+    os.remove(fname)
+  end)
+
+  local function messages(cmd)
+    execute('set verbose=1', 'redir => g:messages', cmd, 'redir END',
+            'set verbose=0')
+    return eval('g:messages')
+  end
+
+  it('reads a big file through a mapping', function()
+    write_file(fname, table.concat(lines, '\n')..'\n')
+    local msg = 'Reading through a memory mapping'
+    assert.is_true(messages('edit '..fname):find(msg, 1, true) ~= nil)
+    execute('bwipe!', 'set mmapsize=0')
+    assert.is_true(messages('edit '..fname):find(msg, 1, true) == nil)
+    eq(lines, curbuf('get_line_slice', 0, -1, true, true))
+  end)
+
+  it('reads a big unix file', function()
+    write_file(fname, table.concat(lines, '\n')..'\n')
+    execute('edit '..fname)
+    eq(lines, curbuf('get_line_slice', 0, -1, true, true))
+    eq('unix', eval('&fileformat'))
+    eq(1, eval('&eol'))
+  end)
+
+  it('reads a big dos file without trailing end-of-line', function()
+    write_file(fname, table.concat(lines, '\r\n'))
+    execute('edit '..fname)
+    eq(lines, curbuf('get_line_slice', 0, -1, true, true))
+    eq('dos', eval('&fileformat'))
+    eq(0, eval('&eol'))
+  end)
+
+  it('switches to unix when a dos line has no CR', function()
+    write_file(fname, table.concat(lines, '\r\n')..'\nlast\r\n')
+    execute('edit '..fname)
+    eq('unix', eval('&fileformat'))
+    eq(501, curbuf('line_count'))
+    eq('line 1\r', curbuf('get_line', 0))
+  end)
+
+  it('translates NULs', function()
+    lines[10] = 'a\0b'
+    write_file(fname, table.concat(lines, '\n')..'\n')
+    execute('edit '..fname)
+    eq('a\nb', eval('getline(10)'))
+    eq(lines, curbuf('get_line_slice', 0, -1, true, true))
+  end)
+end)
@@ -0,0 +1,52 @@
+local helpers = require('test.functional.helpers')
+local clear, eq, eval, ok = helpers.clear, helpers.eq, helpers.eval,
+  helpers.ok
+local curbuf, nvim = helpers.curbuf, helpers.nvim
+
+describe("'pagesize'", function()
+  local fname = 'Xtest-pagesize'
+  local swapname = '.'..fname..'.swp'
+
+  before_each(clear)
+
+  after_each(function()
+    os.remove(swapname)
+  end)
+
+  it('rejects sizes a block cannot have', function()
+    eq(false, pcall(nvim, 'command', 'set pagesize=100'))
+    eq(false, pcall(nvim, 'command', 'set pagesize=100000'))
+    eq(4096, eval('&pagesize'))
+  end)
+
+  it('keeps the text when sparse blocks are merged', function()
+    -- Use commands instead of typed keys, typing would sync the swap file
+    -- before the blocks are merged.
+    nvim('command', 'set pagesize=8192 updatetime=100000 directory=. swapfile')
+    nvim('command', 'edit '..fname)
+    local lines = {}
+    for i = 1, 5000 do
+      lines[i] = ('x'):rep(i % 50)..i
+    end
+    curbuf('set_line_slice', 0, -1, true, true, lines)
+    -- leave a few lines in every block
+    for i = 4900, 100, -100 do
+      curbuf('set_line_slice', i, i + 90, true, true, {})
+    end
+    local expected = curbuf('get_line_slice', 0, -1, true, true)
+    local bytes = eval('line2byte(line("$"))')
+    -- :preserve merges the blocks before writing them, without that the
+    -- swap file would have more than 20 data blocks
+    nvim('command', 'preserve')
+    local size = eval('getfsize("'..swapname..'")')
+    ok(size > 0 and size <= 8 * 8192)
+    eq(expected, curbuf('get_line_slice', 0, -1, true, true))
+    eq(bytes, eval('line2byte(line("$"))'))
+    -- merged blocks can be changed again
+    curbuf('set_line_slice', 50, 50, true, false, {'a', 'b'})
+    table.insert(expected, 51, 'a')
+    table.insert(expected, 52, 'b')
+    eq(expected, curbuf('get_line_slice', 0, -1, true, true))
+    nvim('command', 'bwipe!')
+  end)
+end)
@@ -0,0 +1,55 @@
+local helpers = require('test.functional.helpers')
+local clear, execute, eq, eval = helpers.clear, helpers.execute, helpers.eq,
+  helpers.eval
+local curbuf, wait = helpers.curbuf, helpers.wait
+
+describe(':write', function()
+  local fname = 'Xtest-write'
+
+  before_each(clear)
+
+  after_each(function()
+    os.remove(fname)
+  end)
+
+  local function read_file()
+    local f = io.open(fname, 'rb')
+    local text = f:read('*a')
+    f:close()
+    return text
+  end
+
+  it('writes lines longer than the write buffer', function()
+    local long = ('x'):rep(600 * 1024)
+    curbuf('set_line_slice', 0, -1, true, true, {'a', long, 'b'})
+    execute('write '..fname)
+    eq('a\n'..long..'\nb\n', read_file())
+  end)
+
+  it('writes NULs and line endings for each fileformat', function()
+    curbuf('set_line_slice', 0, -1, true, true, {'a\0b', 'c\rd'})
+    execute('set fileformat=dos', 'write '..fname)
+    eq('a\0b\r\nc\rd\r\n', read_file())
+    execute('set fileformat=mac', 'write! '..fname)
+    eq('a\0b\rc\nd\r', read_file())
+    eq(2, eval('line("$")'))
+  end)
+
+  it("syncs in the background with 'asyncfsync'", function()
+    execute('set fsync asyncfsync',
+            'autocmd BufWriteSynced * let g:synced = expand("<afile>:t")')
+    curbuf('set_line_slice', 0, -1, true, true, {'a', 'b'})
+    execute('write '..fname)
+    local synced
+    for _ = 1, 100 do
+      wait()
+      synced = eval('get(g:, "synced", "")')
+      if synced ~= '' then
+        break
+      end
+    end
+    eq(fname, synced)
+    eq('a\nb\n', read_file())
+    eq(0, eval('&modified'))
+  end)
+end)
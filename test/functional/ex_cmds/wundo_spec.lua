@@ -18,3 +18,45 @@ describe(':wundo', function()
   end)
 
 end)
+
+describe(':rundo', function()
+  local fname = 'Xtest-rundo'
+
+  before_each(clear)
+
+  after_each(function()
+    os.remove(fname)
+  end)
+
+  it('reads the lines of an entry when they are needed', function()
+    feed('ione<cr>two<esc>')
+    feed('odef<esc>')
+    execute('wundo '..fname, 'enew!', 'call setline(1, ["one", "two", "def"])',
+            'set nomodified', 'rundo '..fname)
+    execute('undo')
+    eq({'one', 'two'}, eval('getline(1, "$")'))
+    execute('redo')
+    eq({'one', 'two', 'def'}, eval('getline(1, "$")'))
+  end)
+
+  it('reads the lines after changing directory', function()
+    feed('iabc<esc>odef<esc>')
+    execute('wundo '..fname, 'enew!', 'call setline(1, ["abc", "def"])',
+            'set nomodified', 'rundo '..fname, 'cd ..')
+    execute('undo')
+    eq({'abc'}, eval('getline(1, "$")'))
+    execute('cd -')
+  end)
+
+  it('drops the undo history when the file changed', function()
+    feed('iabc<esc>odef<esc>')
+    execute('wundo '..fname, 'enew!', 'call setline(1, ["abc", "def"])',
+            'set nomodified', 'rundo '..fname)
+    local f = io.open(fname, 'ab')
+    f:write('x')
+    f:close()
+    execute('silent! undo')
+    eq({'abc', 'def'}, eval('getline(1, "$")'))
+    eq(0, eval('undotree().seq_last'))
+  end)
+end)
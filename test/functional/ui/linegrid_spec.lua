@@ -0,0 +1,88 @@
+local helpers = require('test.functional.helpers')
+local Screen = require('test.functional.ui.screen')
+local clear, feed = helpers.clear, helpers.feed
+local request, eq = helpers.request, helpers.eq
+
+describe('linegrid UI protocol', function()
+  local screen
+
+  before_each(function()
+    clear()
+    screen = Screen.new(20, 5)
+    screen:attach(true, {linegrid = true})
+    screen:set_default_attr_ignore({{bold = true, foreground = Screen.colors.Blue}})
+    -- "put" and "highlight_set" are replaced by "line" and "hl_attr_define"
+    screen._handle_put = function()
+      error('unexpected "put" in linegrid mode')
+    end
+    screen._handle_highlight_set = function()
+      error('unexpected "highlight_set" in linegrid mode')
+    end
+  end)
+
+  after_each(function()
+    screen:detach()
+  end)
+
+  it('draws text with repeated cells', function()
+    feed('ihello<cr>aaaaaaaaaa<esc>')
+    screen:expect([[
+      hello               |
+      aaaaaaaaa^a          |
+      ~                   |
+      ~                   |
+                          |
+    ]])
+  end)
+
+  it('draws at the right position after a resize', function()
+    feed('ihello<cr>world<esc>')
+    screen:expect([[
+      hello               |
+      worl^d               |
+      ~                   |
+      ~                   |
+                          |
+    ]])
+    screen:try_resize(25, 6)
+    screen:expect([[
+      hello                    |
+      worl^d                    |
+      ~                        |
+      ~                        |
+      ~                        |
+                               |
+    ]])
+    feed('ggiab<esc>')
+    screen:expect([[
+      a^bhello                  |
+      world                    |
+      ~                        |
+      ~                        |
+      ~                        |
+                               |
+    ]])
+  end)
+
+  it('uses the highlight table', function()
+    screen:set_default_attr_ids({[1] = {bold = true}})
+    feed('i')
+    screen:expect([[
+      ^                    |
+      ~                   |
+      ~                   |
+      ~                   |
+      {1:-- INSERT --}        |
+    ]])
+  end)
+end)
+
+describe('ui_attach options', function()
+  before_each(clear)
+
+  it('rejects unknown options', function()
+    local status, err = pcall(request, 'ui_attach', 20, 5, true, {foo = true})
+    eq(false, status)
+    assert.is_true(err:find('Invalid UI option') ~= nil)
+  end)
+end)
@@ -174,6 +174,7 @@ function Screen.new(width, height)
     _mode = 'normal',
     _mouse_enabled = true,
     _attrs = {},
+    _hl_attrs = {[0] = {}},
     _cursor = {
       row = 1, col = 1
     },
@@ -191,11 +192,15 @@ function Screen:set_default_attr_ignore(attr_ignore)
   self._default_attr_ignore = attr_ignore
 end
 
-function Screen:attach(rgb)
+function Screen:attach(rgb, options)
   if rgb == nil then
     rgb = true
   end
-  request('ui_attach', self._width, self._height, rgb)
+  if options then
+    request('ui_attach', self._width, self._height, rgb, options)
+  else
+    request('ui_attach', self._width, self._height, rgb)
+  end
 end
 
 function Screen:detach()
@@ -397,6 +402,27 @@ function Screen:_handle_put(str)
   self._cursor.col = self._cursor.col + 1
 end
 
+function Screen:_handle_hl_attr_define(id, attrs)
+  self._hl_attrs[id] = attrs
+end
+
+function Screen:_handle_line(row, col, cells)
+  local line = self._rows[row + 1]
+  local hl_id = 0
+  col = col + 1
+  for _, cell in ipairs(cells) do
+    local text, repeat_count = cell[1], cell[3] or 1
+    hl_id = cell[2] or hl_id
+    for _ = 1, repeat_count do
+      line[col].text = text
+      line[col].attrs = self._hl_attrs[hl_id]
+      col = col + 1
+    end
+  end
+  self._cursor.row = row + 1
+  self._cursor.col = col
+end
+
 function Screen:_handle_bell()
   self.bell = true
 end
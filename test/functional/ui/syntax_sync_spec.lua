@@ -0,0 +1,99 @@
+local helpers = require('test.functional.helpers')
+local Screen = require('test.functional.ui.screen')
+local clear, execute, eq, eval = helpers.clear, helpers.execute, helpers.eq,
+  helpers.eval
+local curbuf = helpers.curbuf
+
+describe('syntax state cache', function()
+  local screen
+
+  local function syn_name(lnum)
+    return eval('synIDattr(synID('..lnum..', 1, 1), "name")')
+  end
+
+  before_each(function()
+    clear()
+    screen = Screen.new(20, 5)
+    screen:attach()
+    local lines = {'"'}
+    for i = 2, 20000 do
+      lines[i] = 'line '..i
+    end
+    curbuf('set_line_slice', 0, -1, true, true, lines)
+    execute('syntax region Str start=/"/ end=/"/', 'syntax sync fromstart',
+            'normal! G', 'redraw')
+  end)
+
+  after_each(function()
+    screen:detach()
+  end)
+
+  it('keeps states below a change that does not affect them', function()
+    eq('Str', syn_name(20000))
+    execute('call setline(10000, "x")', 'normal! G', 'redraw')
+    eq('Str', syn_name(20000))
+    eq('Str', syn_name(15000))
+  end)
+
+  it('updates states below a change that affects them', function()
+    execute('call setline(10000, "\\"")', 'normal! G', 'redraw')
+    eq('', syn_name(20000))
+    eq('Str', syn_name(5000))
+    execute('undo', 'normal! G', 'redraw')
+    eq('Str', syn_name(20000))
+  end)
+
+  it('updates states after the stack was cleaned up', function()
+    -- More lines than SST_MAX_ENTRIES * SST_DIST, so that the state stack
+    -- is full after parsing and storing the states of the displayed lines
+    -- makes it clean up entries.
+    local lines = {'"'}
+    for i = 2, 130000 do
+      lines[i] = 'line '..i
+    end
+    curbuf('set_line_slice', 0, -1, true, true, lines)
+    execute('normal! G', 'redraw',
+            'for i in range(1, 130000, 500) | exe i | redraw | endfor')
+    eq('Str', syn_name(130000))
+    -- The last state found is near the end, change a line far above it.
+    execute('call setline(100, "\\"")', 'normal! G', 'redraw')
+    eq('', syn_name(130000))
+    eq('', syn_name(60000))
+    eq('Str', syn_name(99))
+    execute('undo', 'normal! G', 'redraw')
+    eq('Str', syn_name(130000))
+    eq('Str', syn_name(60000))
+  end)
+
+  it('gives the same result after parsing ahead when idle', function()
+    -- Number of times a pattern was tried, as counted by ":syntime".
+    local function tried()
+      return eval('eval(join(map(getsyntime(), "v:val.count"), "+"))')
+    end
+    -- Parsing ahead is done when there is no typeahead, wait until the
+    -- patterns were tried "count" times.
+    local function wait_parsed_ahead(count)
+      for _ = 1, 500 do
+        if tried() >= count then
+          return
+        end
+        os.execute('sleep 0.01')
+      end
+      error('parsing ahead did not reach the end of the buffer')
+    end
+
+    execute('syntime on', 'set updatetime=1', 'normal! gg', 'redraw')
+    local start = tried()
+    execute('call setline(10000, "\\"")', 'redraw')
+    -- lines 10000 to 20000 are parsed again
+    wait_parsed_ahead(start + 10000)
+    execute('normal! G', 'redraw')
+    eq('', syn_name(20000))
+    eq('Str', syn_name(9999))
+    start = tried()
+    execute('undo', 'normal! gg', 'redraw')
+    wait_parsed_ahead(start + 10000)
+    execute('normal! G', 'redraw')
+    eq('Str', syn_name(20000))
+  end)
+end)
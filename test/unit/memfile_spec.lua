@@ -0,0 +1,103 @@
+local helpers = require("test.unit.helpers")
+
+local cimport = helpers.cimport
+local eq = helpers.eq
+local neq = helpers.neq
+local NULL = helpers.NULL
+
+local memfile = cimport('./src/nvim/memfile.h')
+
+-- The block hash table is static, it is tested through the functions that
+-- add, find and remove blocks. A memfile without a file keeps all blocks in
+-- memory, so mf_get() only finds blocks that are in the hash table.
+describe('memfile block hash table', function()
+  local mfp
+  local blocks
+
+  before_each(function()
+    mfp = memfile.mf_open(NULL, 0)
+    blocks = {}
+  end)
+
+  after_each(function()
+    memfile.mf_close(mfp, false)
+  end)
+
+  -- Creates a block of "page_count" pages and returns its number.
+  local function new_block(negative, page_count)
+    local hp = memfile.mf_new(mfp, negative, page_count)
+    memfile.mf_put(mfp, hp, false, false)
+    local nr = tonumber(hp.bh_bnum)
+    blocks[nr] = {hp = hp, page_count = page_count}
+    return nr
+  end
+
+  local function free_block(nr)
+    memfile.mf_free(mfp, blocks[nr].hp)
+    blocks[nr] = nil
+  end
+
+  local function is_found(nr, page_count)
+    local hp = memfile.mf_get(mfp, nr, page_count or 1)
+    if hp == NULL then
+      return false
+    end
+    eq(nr, tonumber(hp.bh_bnum))
+    memfile.mf_put(mfp, hp, false, false)
+    return true
+  end
+
+  local function check_all_found()
+    for nr, block in pairs(blocks) do
+      eq(true, is_found(nr, block.page_count))
+    end
+  end
+
+  it('finds colliding keys wrapping around the end of the table', function()
+    local mask = tonumber(mfp.mf_hash.mht_mask)
+    -- Negative numbers hash to the last slots, -1 to the last one
+    eq(-1, new_block(true, 1))
+    eq(-2, new_block(true, 1))
+    -- Block 0 occupies pages up to "mask - 2", the next blocks hash to the
+    -- slots of -2 and -1 and to slot 0, their probe runs wrap around
+    eq(0, new_block(false, mask - 1))
+    eq(mask - 1, new_block(false, 1))
+    eq(mask, new_block(false, 1))
+    eq(mask + 1, new_block(false, 1))
+    eq(mask, tonumber(mfp.mf_hash.mht_mask))
+    check_all_found()
+
+    -- Remove from the middle of the probe run, before and after the end of
+    -- the table
+    free_block(-1)
+    eq(false, is_found(-1))
+    check_all_found()
+    free_block(0)
+    check_all_found()
+    free_block(mask)
+    check_all_found()
+    free_block(-2)
+    check_all_found()
+    eq(2, tonumber(mfp.mf_hash.mht_count))
+  end)
+
+  it('finds all keys after growing and removing', function()
+    local initial_mask = tonumber(mfp.mf_hash.mht_mask)
+    for _ = 1, 300 do
+      new_block(true, 1)
+      new_block(false, 1)
+    end
+    neq(initial_mask, tonumber(mfp.mf_hash.mht_mask))
+    check_all_found()
+
+    for nr = -1, -300, -3 do
+      free_block(nr)
+    end
+    for nr = 0, 299, 4 do
+      free_block(nr)
+    end
+    check_all_found()
+    eq(false, is_found(-1))
+    eq(false, is_found(-298))
+  end)
+end)
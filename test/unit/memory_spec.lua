@@ -0,0 +1,51 @@
+local helpers = require("test.unit.helpers")
+
+local cimport = helpers.cimport
+local eq = helpers.eq
+local neq = helpers.neq
+local ffi = helpers.ffi
+local to_cstr = helpers.to_cstr
+
+local memory = cimport('./src/nvim/memory.h')
+
+describe('arena', function()
+  local arena
+
+  before_each(function()
+    arena = ffi.new('Arena[1]')
+  end)
+
+  after_each(function()
+    memory.arena_mem_free(arena)
+  end)
+
+  it('returns aligned, non-overlapping memory', function()
+    local a = memory.arena_alloc(arena, 3, false)
+    local b = memory.arena_alloc(arena, 8, true)
+    neq(ffi.NULL, a)
+    neq(ffi.NULL, b)
+    eq(0, ffi.cast('uintptr_t', b) % ffi.sizeof('void *'))
+    assert.is_true(ffi.cast('char *', b) >= ffi.cast('char *', a) + 3)
+  end)
+
+  it('handles allocations bigger than a block', function()
+    local small = memory.arena_alloc(arena, 16, true)
+    local big = memory.arena_alloc(arena, 100000, true)
+    ffi.fill(big, 100000, 42)
+    local small2 = memory.arena_alloc(arena, 16, true)
+    -- small allocations keep using the current block
+    eq(16, ffi.cast('char *', small2) - ffi.cast('char *', small))
+  end)
+
+  it('copies strings', function()
+    local str = memory.arena_memdupz(arena, to_cstr('abcdef'), 3)
+    eq('abc', ffi.string(str))
+  end)
+
+  it('resets the arena when freed', function()
+    memory.arena_alloc(arena, 16, true)
+    memory.arena_mem_free(arena)
+    eq(ffi.NULL, arena[0].cur_blk)
+    eq(0, arena[0].pos)
+  end)
+end)